@@ -50,54 +50,141 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////////////
 
-#ifndef _WIN32
+#ifdef _WIN32
+#include <intrin.h>
+#else
 #include <atomic>
 #endif
+
 /**
-This is the base implementation of the PXCAddRef interface.
+This is the default reference counter of PXCAddRefImpl. Increments are relaxed, as
+a new reference can only be made from an existing one; decrements release, and the
+final decrement acquires before the object is destroyed. The counter is padded on
+both sides so that its cache line holds nothing else, and reference traffic from
+other threads does not evict the object's hot data.
 */
-template <class T>
-class PXCAddRefImpl:public T, public PXCAddRef {
+class PXCRefCount {
 public:
+    enum { CACHE_LINE = 64 };
 
-    PXCAddRefImpl()
-    {
-        m_refCount = 1;
+    explicit PXCRefCount(pxcI32 count = 1) { Reset(count); }
+
+    /** @brief Reinitialize the counter of an object that no other thread references. */
+    void Reset(pxcI32 count = 1) {
+#ifdef _WIN32
+        m_count = count;
+#else
+        m_count.store(count, std::memory_order_relaxed);
+#endif
     }
 
-	virtual ~PXCAddRefImpl(void) {}
+    /** @brief Add a reference. @return The increased counter value. */
+    pxcI32 Increment(void) {
+#ifdef _WIN32
+        return _InterlockedIncrement((volatile long*)&m_count);
+#else
+        return m_count.fetch_add(1, std::memory_order_relaxed) + 1;
+#endif
+    }
 
-    virtual pxcI32 PXCAPI AddRef(void)
-    {
+    /** @brief Remove a reference. @return The decreased counter value; at zero, all writes of the other owners are visible. */
+    pxcI32 Decrement(void) {
 #ifdef _WIN32
-        return _InterlockedIncrement((volatile long*)&m_refCount);
+        return _InterlockedDecrement((volatile long*)&m_count);
 #else
-        return ++m_refCount;
+        pxcI32 count = m_count.fetch_sub(1, std::memory_order_release) - 1;
+        if (!count) std::atomic_thread_fence(std::memory_order_acquire);
+        return count;
 #endif
     }
 
-    virtual void   PXCAPI Release(void)
-    {
+    /** @brief Return the counter value. The value is a snapshot when other threads hold references. */
+    pxcI32 Query(void) const {
 #ifdef _WIN32
-        if (!_InterlockedDecrement((volatile long*)&m_refCount)) ::delete this;
+        return m_count;
 #else
-        if (!--m_refCount) ::delete this;
+        return m_count.load(std::memory_order_relaxed);
 #endif
     }
 
+protected:
+    char m_before[CACHE_LINE - sizeof(pxcI32)];
+#ifdef _WIN32
+    volatile long m_count;
+#else
+    std::atomic<int> m_count;
+#endif
+    char m_after[CACHE_LINE - sizeof(pxcI32)];
+};
+
+/**
+This reference counter uses plain integer operations, for objects that are created,
+referenced and released by a single thread, such as the per-frame scratch data of a
+module. Use PXCRefCount for any object whose references cross threads.
+*/
+class PXCRefCountSingleOwner {
+public:
+
+    explicit PXCRefCountSingleOwner(pxcI32 count = 1):m_count(count) {}
+    void   Reset(pxcI32 count = 1) { m_count = count; }
+    pxcI32 Increment(void) { return ++m_count; }
+    pxcI32 Decrement(void) { return --m_count; }
+    pxcI32 Query(void) const { return m_count; }
+
+protected:
+    pxcI32 m_count;
+};
+
+/**
+This is the base implementation of the PXCAddRef interface. The Counter parameter
+selects the reference counter: PXCRefCount, or PXCRefCountSingleOwner for objects
+that never leave their thread.
+*/
+template <class T, class Counter = PXCRefCount>
+class PXCAddRefImpl:public T, public PXCAddRef {
+public:
+
+    PXCAddRefImpl() {}
+
+	virtual ~PXCAddRefImpl(void) {}
+
+    virtual pxcI32 PXCAPI AddRef(void)
+    {
+        return m_refCount.Increment();
+    }
+
+    virtual void   PXCAPI Release(void)
+    {
+        if (!ReleaseRef()) delete this;
+    }
+
     virtual void* PXCAPI QueryInstance(pxcUID cuid)
     {
         return (cuid == PXCAddRef::CUID) ? (PXCAddRef*)this : T::QueryInstance(cuid);
     }
 
-    void operator delete(void* pthis) { ((PXCBase*)pthis)->Release(); }
+    void operator delete(void* pthis) { ::operator delete(pthis); }
 
 protected:
-#ifdef _WIN32
-    __declspec(align(32)) pxcI32  m_refCount;
-#else
-    std::atomic<int>  m_refCount;
-#endif
+    /**
+        @brief Decrease the reference counter without destroying the object. Implementations
+        that recycle objects override Release and call this function instead.
+        @return The decreased reference counter value.
+    */
+    pxcI32 ReleaseRef(void)
+    {
+        return m_refCount.Decrement();
+    }
+
+    /**
+        @brief Reset the reference counter to one reference, for recycled objects.
+    */
+    void ResetRef(void)
+    {
+        m_refCount.Reset();
+    }
+
+    Counter m_refCount;
 };
 
 #endif
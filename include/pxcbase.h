@@ -94,8 +94,8 @@ private:
    such as a callback handler, should derive the implementation from this
    template class.  See the SDK Interface section (in the sdkcore manual)
    for details.  The PXCBaseImpl template assumes single inheritance.
-   The variations, PXCBaseImpl2 and PXCBaseImpl3, implement two or three
-   inheritances, respectively.
+   The variation PXCBaseImplN implements any number of inheritances;
+   PXCBaseImpl2 through PXCBaseImpl6 are its two to six interface forms.
 */
 template <class T>
 class PXCBaseImpl:public T {
@@ -109,105 +109,70 @@ public:
         if (cuid==PXCBase::CUID) return (PXCBase*)this;
         return 0; 
     }
-    virtual void  PXCAPI Release(void) { ::delete this; }
-    void operator delete(void* pthis) { ::delete(pthis); }
+    virtual void  PXCAPI Release(void) { delete this; }
+    void operator delete(void* pthis) { ::operator delete(pthis); }
 };
 
-/** See PXCBaseImpl */
-template <class T1, class T2>
-class PXCBaseImpl2:public T1, public T2 {
-public:
-
-    virtual ~PXCBaseImpl2(void) {}
-    enum { CUID = T1::CUID ^ T2::CUID };
-    virtual void* PXCAPI QueryInstance(pxcUID cuid) {
-        if (cuid==CUID) return this;
-        if (cuid==T1::CUID) return (T1*)this;
-        if (cuid==T2::CUID) return (T2*)this;
-        if (cuid==PXCBase::CUID) return (PXCBase*)(T1*)this;
-        return 0;
+/**
+   The interface list of PXCBaseImplN. CUID combines the interface identifiers,
+   and Find evaluates every comparison and selects the matching interface, so the
+   lookup is a short sequence of conditional moves over casts that the compiler
+   folds into constant offsets. The first interface in the list wins.
+*/
+template <class... Ts>
+struct PXCInterfaceList;
+
+template <class T, class... Ts>
+struct PXCInterfaceList<T, Ts...> {
+    enum { CUID = (pxcUID)T::CUID ^ (pxcUID)PXCInterfaceList<Ts...>::CUID };
+    enum { UNIQUE = !PXCInterfaceList<Ts...>::template Has<T::CUID>::value && PXCInterfaceList<Ts...>::UNIQUE };
+    template <pxcUID C> struct Has { enum { value = (T::CUID == C) || PXCInterfaceList<Ts...>::template Has<C>::value }; };
+    template <class D> static void *Find(D *self, pxcUID cuid) {
+        void *next = PXCInterfaceList<Ts...>::Find(self, cuid);
+        return (cuid == T::CUID) ? (void*)static_cast<T*>(self) : next;
     }
-    virtual void  PXCAPI Release(void) { ::delete this; }
-    void operator delete(void* pthis) { ::delete(pthis); }
+};
+
+template <>
+struct PXCInterfaceList<> {
+    enum { CUID = 0, UNIQUE = 1 };
+    template <pxcUID C> struct Has { enum { value = 0 }; };
+    template <class D> static void *Find(D*, pxcUID) { return 0; }
 };
 
 /** See PXCBaseImpl */
-template <class T1, class T2, class T3>
-class PXCBaseImpl3:public T1, public T2, public T3 {
+template <class T1, class... Ts>
+class PXCBaseImplN:public T1, public Ts... {
 public:
 
-    virtual ~PXCBaseImpl3(void) {}
-    enum { CUID = T1::CUID ^ T2::CUID ^ T3::CUID };
+    virtual ~PXCBaseImplN(void) {}
+    enum { CUID = PXCInterfaceList<T1, Ts...>::CUID };
     virtual void* PXCAPI QueryInstance(pxcUID cuid) {
+        static_assert(PXCInterfaceList<T1, Ts...>::UNIQUE, "PXCBaseImplN: duplicate interface identifiers");
         if (cuid==CUID) return this;
-        if (cuid==T1::CUID) return (T1*)this;
-        if (cuid==T2::CUID) return (T2*)this;
-        if (cuid==T3::CUID) return (T3*)this;
         if (cuid==PXCBase::CUID) return (PXCBase*)(T1*)this;
-        return 0;
+        return PXCInterfaceList<T1, Ts...>::Find(this, cuid);
     }
-    virtual void  PXCAPI Release(void) { ::delete this; }
-    void operator delete(void* pthis) { ::delete(pthis); }
+    virtual void  PXCAPI Release(void) { delete this; }
+    void operator delete(void* pthis) { ::operator delete(pthis); }
 };
 
 /** See PXCBaseImpl */
-template <class T1, class T2, class T3, class T4>
-class PXCBaseImpl4:public T1, public T2, public T3, public T4 {
-public:
+template <class T1, class T2>
+class PXCBaseImpl2:public PXCBaseImplN<T1, T2> {};
 
-    virtual ~PXCBaseImpl4(void) {}
-    enum { CUID = T1::CUID ^ T2::CUID ^ T3::CUID ^ T4::CUID };
-    virtual void* PXCAPI QueryInstance(pxcUID cuid) {
-        if (cuid==CUID) return this;
-        if (cuid==T1::CUID) return (T1*)this;
-        if (cuid==T2::CUID) return (T2*)this;
-        if (cuid==T3::CUID) return (T3*)this;
-        if (cuid==T4::CUID) return (T4*)this;
-        if (cuid==PXCBase::CUID) return (PXCBase*)(T1*)this;
-        return 0;
-    }
-    virtual void  PXCAPI Release(void) { ::delete this; }
-    void operator delete(void* pthis) { ::delete(pthis); }
-};
+/** See PXCBaseImpl */
+template <class T1, class T2, class T3>
+class PXCBaseImpl3:public PXCBaseImplN<T1, T2, T3> {};
 
 /** See PXCBaseImpl */
-template <class T1, class T2, class T3, class T4, class T5>
-class PXCBaseImpl5:public T1, public T2, public T3, public T4, public T5 {
-public:
+template <class T1, class T2, class T3, class T4>
+class PXCBaseImpl4:public PXCBaseImplN<T1, T2, T3, T4> {};
 
-    virtual ~PXCBaseImpl5(void) {}
-    enum { CUID = T1::CUID ^ T2::CUID ^ T3::CUID ^ T4::CUID ^ T5::CUID };
-    virtual void* PXCAPI QueryInstance(pxcUID cuid) {
-        if (cuid==CUID) return this;
-        if (cuid==T1::CUID) return (T1*)this;
-        if (cuid==T2::CUID) return (T2*)this;
-        if (cuid==T3::CUID) return (T3*)this;
-        if (cuid==T4::CUID) return (T4*)this;
-        if (cuid==T5::CUID) return (T5*)this;
-        if (cuid==PXCBase::CUID) return (PXCBase*)(T1*)this;
-        return 0;
-    }
-    virtual void  PXCAPI Release(void) { ::delete this; }
-    void operator delete(void* pthis) { ::delete(pthis); }
-};
+/** See PXCBaseImpl */
+template <class T1, class T2, class T3, class T4, class T5>
+class PXCBaseImpl5:public PXCBaseImplN<T1, T2, T3, T4, T5> {};
 
+/** See PXCBaseImpl */
 template <class T1, class T2, class T3, class T4, class T5, class T6>
-class PXCBaseImpl6:public T1, public T2, public T3, public T4, public T5, public T6 {
-public:
-
-    virtual ~PXCBaseImpl6(void) {}
-    enum { CUID = T1::CUID ^ T2::CUID ^ T3::CUID ^ T4::CUID ^ T5::CUID ^ T6::CUID };
-    virtual void* PXCAPI QueryInstance(pxcUID cuid) {
-        if (cuid==CUID) return this;
-        if (cuid==T1::CUID) return (T1*)this;
-        if (cuid==T2::CUID) return (T2*)this;
-        if (cuid==T3::CUID) return (T3*)this;
-        if (cuid==T4::CUID) return (T4*)this;
-        if (cuid==T5::CUID) return (T5*)this;
-        if (cuid==T6::CUID) return (T6*)this;
-        if (cuid==PXCBase::CUID) return (PXCBase*)(T1*)this;
-        return 0;
-    }
-    virtual void  PXCAPI Release(void) { ::delete this; }
-    void operator delete(void* pthis) { ::delete(pthis); }
-};
+class PXCBaseImpl6:public PXCBaseImplN<T1, T2, T3, T4, T5, T6> {};
@@ -113,7 +113,8 @@ public:
     */
     struct ImageData {
         PixelFormat     format;                     /* image pixel format */
-        pxcI32          reserved[3];
+        pxcI32          alignment;                  /* the byte alignment of the plane pointers and pitches, or zero if unknown */
+        pxcI32          reserved[2];
         pxcI32          pitches[NUM_OF_PLANES];     /* image pitches */
         pxcBYTE*        planes[NUM_OF_PLANES];      /* image buffers */
     };
@@ -128,6 +129,15 @@ public:
         ACCESS_READ_WRITE   = ACCESS_READ | ACCESS_WRITE,   /* read write access    */
     };
 
+    /** 
+    @enum ImportFlag
+    Describes the ImportData flags. Implementations that cannot reference external
+    buffers copy the image data.
+    */
+    enum ImportFlag {
+        IMPORT_FLAG_ADOPT   = 0x00000001,   /* reference the buffer without copying */
+    };
+
     /**
     @enum Rotation
     Image rotation options.
@@ -208,7 +218,9 @@ public:
     /** 
     @brief Copy image data from the specified external buffer.
     @param[in] data             The ImageData structure that describes the image buffer.
-    @param[in] flags            Reserved.
+    @param[in] flags            The ImportFlag flags. IMPORT_FLAG_ADOPT references the buffer
+                                instead of copying it; the application must keep the buffer
+                                valid while the image exists or until another import.
     @return PXC_STATUS_NO_ERROR     Successful execution.
     */
     virtual pxcStatus PXCAPI ImportData(ImageData *data, pxcEnum flags)=0;
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcimagepyramid.h
+    Defines the PXCImagePyramid interface, which provides access to
+    downscaled versions of an image.
+ */
+#pragma once
+#include "pxcimage.h"
+
+/**
+    This interface provides read access to a mip pyramid of an image: level 0
+    is the image itself, and each level halves the width and height of the
+    previous one, rounding up. Levels are generated on first access and cached
+    until the image is written.
+
+    The PXCImage implementation exposes the PXCImagePyramid interface. Use
+    QueryInstance<PXCImagePyramid>() to access the PXCImagePyramid features.
+ */
+class PXCImagePyramid:public PXCBase {
+public:
+    PXC_CUID_OVERWRITE(0x5D7A21C4);
+
+    /**
+        @enum Filter
+        Describes how four pixels of a level are reduced to one pixel of the next level.
+    */
+    enum Filter {
+        FILTER_DEFAULT=0,               /* FILTER_BOX for color and IR formats, FILTER_MEDIAN_VALID for depth formats */
+        FILTER_BOX,                     /* The rounded average of the 2x2 pixels, per channel */
+        FILTER_MIN_VALID,               /* Depth: the nearest valid (nonzero) depth of the 2x2 pixels */
+        FILTER_MEDIAN_VALID,            /* Depth: the lower median of the valid (nonzero) depths of the 2x2 pixels */
+    };
+
+    /**
+        @brief Return the number of pyramid levels, including level 0. The last level is one pixel in size.
+        @return the number of levels.
+    */
+    virtual pxcI32 PXCAPI QueryLevels(void)=0;
+
+    /**
+        @brief Return the image information of a pyramid level.
+        @param[in] level        The zero-based level.
+        @return the image information, with zero width and height if the level is not available.
+    */
+    virtual PXCImage::ImageInfo PXCAPI QueryLevelInfo(pxcI32 level)=0;
+
+    /**
+        @brief Lock a pyramid level for read access, in a specific pixel format. The level
+        is generated from the previous level if it is not cached.
+        @param[in] level        The zero-based level.
+        @param[in] format       The requested pixel format, or PIXEL_FORMAT_ANY for the native format.
+        @param[in] filter       The downscaling filter.
+        @param[out] data        The image data, to be returned.
+        @return PXC_STATUS_NO_ERROR             Successful execution.
+        @return PXC_STATUS_ITEM_UNAVAILABLE     The level is not available.
+        @return PXC_STATUS_PARAM_UNSUPPORTED    Unsupported pixel format or filter.
+    */
+    virtual pxcStatus PXCAPI AcquireLevelAccess(pxcI32 level, PXCImage::PixelFormat format, Filter filter, PXCImage::ImageData *data)=0;
+
+    /**
+        @brief Lock a pyramid level for read access in the native pixel format, with the default filter.
+        @param[in] level        The zero-based level.
+        @param[out] data        The image data, to be returned.
+        @return PXC_STATUS_NO_ERROR             Successful execution.
+        @return PXC_STATUS_ITEM_UNAVAILABLE     The level is not available.
+    */
+    __inline pxcStatus PXCAPI AcquireLevelAccess(pxcI32 level, PXCImage::ImageData *data) {
+        return AcquireLevelAccess(level, PXCImage::PIXEL_FORMAT_ANY, FILTER_DEFAULT, data);
+    }
+
+    /**
+        @brief Unlock a pyramid level locked by AcquireLevelAccess.
+        @param[in] data         The image data to be released.
+        @return PXC_STATUS_NO_ERROR             Successful execution.
+    */
+    virtual pxcStatus PXCAPI ReleaseLevelAccess(PXCImage::ImageData *data)=0;
+};
@@ -0,0 +1,273 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcptr.h
+    Defines PXCPtr and the scoped helpers that release SDK objects, image
+    access, capture samples and sync points automatically.
+ */
+#pragma once
+#include "pxcaddref.h"
+#include "pxccapture.h"
+#include "pxcsyncpoint.h"
+#include <stddef.h>
+
+/**
+    This class template owns one reference to an SDK object and releases it
+    on destruction. Ownership moves without touching the reference count;
+    the only way to add a reference is an explicit Share or As call, which
+    requires the object to support the PXCAddRef interface.
+
+    Construct or Attach with a pointer the caller already owns, such as the
+    result of a Create function. Use Receive to pass the pointer to functions
+    that return an object through a T** argument.
+ */
+template <class T>
+class PXCPtr {
+public:
+
+    PXCPtr(void):object(0) {}
+    explicit PXCPtr(T *object):object(object) {}
+    PXCPtr(PXCPtr &&other):object(other.object) { other.object = 0; }
+    ~PXCPtr(void) { if (object) object->Release(); }
+
+    PXCPtr& operator=(PXCPtr &&other) {
+        if (this != &other) Attach(other.Detach());
+        return *this;
+    }
+
+    /**
+        @brief Return a new owner of the same object, adding a reference.
+        @return The new owner, or an empty pointer if the object is not reference counted.
+    */
+    PXCPtr Share(void) const {
+        return PXCPtr(AddRef(object));
+    }
+
+    /**
+        @brief Return an owner of another interface of the same object, adding a reference.
+        @return The new owner, or an empty pointer if the interface is not supported or
+        the object is not reference counted.
+    */
+    template <class U> PXCPtr<U> As(void) const {
+        U *other = object ? object->template QueryInstance<U>() : 0;
+        return PXCPtr<U>(other ? (AddRef(object) ? other : 0) : 0);
+    }
+
+    /**
+        @brief Release the owned object, if any, and take ownership of the new one.
+        @param[in] object    The object whose reference passes to this pointer.
+    */
+    void Attach(T *object) {
+        T *previous = this->object;
+        this->object = object;
+        if (previous) previous->Release();
+    }
+
+    /**
+        @brief Give up ownership without releasing the object.
+        @return The object, whose reference passes to the caller.
+    */
+    T* Detach(void) {
+        T *result = object;
+        object = 0;
+        return result;
+    }
+
+    /**
+        @brief Release the owned object, if any, and return the address of the empty pointer
+        to receive a new object.
+    */
+    T** Receive(void) {
+        Attach(0);
+        return &object;
+    }
+
+    T* Get(void) const { return object; }
+    T* operator->(void) const { return object; }
+    T& operator*(void) const { return *object; }
+    explicit operator bool(void) const { return object != 0; }
+
+protected:
+
+    static T* AddRef(T *object) {
+        PXCAddRef *addRef = object ? object->template QueryInstance<PXCAddRef>() : 0;
+        if (!addRef) return 0;
+        addRef->AddRef();
+        return object;
+    }
+
+    T *object;
+
+private:
+    PXCPtr(const PXCPtr&);
+    PXCPtr& operator=(const PXCPtr&);
+};
+
+/**
+    This class acquires access to the image planes and releases the access
+    on destruction. Check QueryStatus, or test the object, before using the
+    image data. The image must outlive the access.
+ */
+class PXCImageAccess {
+public:
+
+    PXCImageAccess(void):image(0),status(PXC_STATUS_HANDLE_INVALID),data() {}
+
+    /**
+        @brief Acquire access to the image; see PXCImage::AcquireAccess.
+    */
+    PXCImageAccess(PXCImage *image, PXCImage::Access access, PXCImage::PixelFormat format=PXCImage::PIXEL_FORMAT_ANY,
+            PXCImage::Option options=PXCImage::OPTION_ANY):image(0),data() {
+        status = image ? image->AcquireAccess(access, format, options, &data) : PXC_STATUS_HANDLE_INVALID;
+        if (status >= PXC_STATUS_NO_ERROR) this->image = image;
+    }
+
+    PXCImageAccess(PXCImageAccess &&other):image(other.image),status(other.status),data(other.data) {
+        other.image = 0;
+        other.status = PXC_STATUS_HANDLE_INVALID;
+    }
+
+    ~PXCImageAccess(void) { Release(); }
+
+    PXCImageAccess& operator=(PXCImageAccess &&other) {
+        if (this != &other) {
+            Release();
+            image = other.image, status = other.status, data = other.data;
+            other.image = 0;
+            other.status = PXC_STATUS_HANDLE_INVALID;
+        }
+        return *this;
+    }
+
+    /**
+        @brief Release the access early. The object becomes empty.
+        @return The status of PXCImage::ReleaseAccess, or PXC_STATUS_NO_ERROR if there was no access.
+    */
+    pxcStatus Release(void) {
+        pxcStatus sts = PXC_STATUS_NO_ERROR;
+        if (image) sts = image->ReleaseAccess(&data);
+        image = 0;
+        status = PXC_STATUS_HANDLE_INVALID;
+        return sts;
+    }
+
+    /**
+        @brief Return the status of the AcquireAccess call.
+    */
+    pxcStatus QueryStatus(void) const { return status; }
+
+    const PXCImage::ImageData& operator*(void) const { return data; }
+    const PXCImage::ImageData* operator->(void) const { return &data; }
+    explicit operator bool(void) const { return image != 0; }
+
+protected:
+
+    PXCImage *image;
+    pxcStatus status;
+    PXCImage::ImageData data;
+
+private:
+    PXCImageAccess(const PXCImageAccess&);
+    PXCImageAccess& operator=(const PXCImageAccess&);
+};
+
+/**
+    This structure is a PXCCapture::Sample that releases its images on
+    destruction. Pass it wherever the SDK fills in a sample the application
+    owns, such as PXCCapture::Device::ReadStreams.
+ */
+struct PXCSampleScope:public PXCCapture::Sample {
+
+    PXCSampleScope(void) {}
+
+    PXCSampleScope(PXCSampleScope &&other):PXCCapture::Sample(other) {
+        other.color = other.depth = other.ir = other.left = other.right = 0;
+        for (size_t i=0;i<sizeof(reserved)/sizeof(reserved[0]);i++) other.reserved[i] = 0;
+    }
+
+    ~PXCSampleScope(void) { ReleaseImages(); }
+
+    PXCSampleScope& operator=(PXCSampleScope &&other) {
+        if (this != &other) {
+            ReleaseImages();
+            PXCCapture::Sample::operator=(other);
+            other.color = other.depth = other.ir = other.left = other.right = 0;
+            for (size_t i=0;i<sizeof(reserved)/sizeof(reserved[0]);i++) other.reserved[i] = 0;
+        }
+        return *this;
+    }
+
+private:
+    PXCSampleScope(const PXCSampleScope&);
+    PXCSampleScope& operator=(const PXCSampleScope&);
+};
+
+/**
+    This class template holds up to N sync points and releases them on
+    destruction or when reused. Empty slots are skipped, as in
+    PXCSyncPoint::SynchronizeEx.
+ */
+template <int N = PXCSyncPoint::SYNCEX_LIMIT>
+class PXCSyncPointArray {
+public:
+
+    PXCSyncPointArray(void):sps() {}
+    ~PXCSyncPointArray(void) { Release(); }
+
+    /**
+        @brief Return the slot at the index. Asynchronous functions write their
+        sync point to &array[i]; release the previous one first with Release(i).
+    */
+    PXCSyncPoint*& operator[](int index) { return sps[index]; }
+
+    /**
+        @brief Release the sync point at the index, if any.
+    */
+    void Release(int index) { PXCSyncPoint::ReleaseSP(sps, index, 1); }
+
+    /**
+        @brief Release all sync points.
+    */
+    void Release(void) { PXCSyncPoint::ReleaseSP(sps, 0, N); }
+
+    /**
+        @brief Synchronize the sync points; see PXCSyncPoint::SynchronizeEx.
+    */
+    pxcStatus SynchronizeEx(pxcI32 *idx=0, pxcI32 timeout=PXCSyncPoint::TIMEOUT_INFINITE) {
+        return PXCSyncPoint::SynchronizeEx(N, sps, idx, timeout);
+    }
+
+    PXCSyncPoint** Get(void) { return sps; }
+    int QuerySize(void) const { return N; }
+
+protected:
+
+    PXCSyncPoint *sps[N];
+
+private:
+    PXCSyncPointArray(const PXCSyncPointArray&);
+    PXCSyncPointArray& operator=(const PXCSyncPointArray&);
+};
@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcimageconversion.h
+    Defines PXCImageConversion, the pixel format conversion library behind
+    PXCImage::AcquireAccess. It converts among the color formats, among the
+    depth formats, and from the IR formats to Y8. Kernels are selected at run time from the instruction
+    sets the processor supports; every SIMD kernel produces the same output
+    as its scalar reference.
+ */
+#pragma once
+#include "pxcimage.h"
+#include <string.h>
+
+class PXCImageConversion {
+public:
+
+    /**
+        @enum CpuFeature
+        The instruction sets used by the conversion kernels.
+    */
+    enum CpuFeature {
+        CPU_FEATURE_NONE    = 0,            /* scalar reference kernels */
+        CPU_FEATURE_SSE41   = 0x00000001,   /* SSE4.1 kernels */
+        CPU_FEATURE_AVX2    = 0x00000002,   /* AVX2 kernels */
+        CPU_FEATURE_AVX512  = 0x00000004,   /* AVX-512 (F and BW) kernels */
+        CPU_FEATURE_ALL     = 0x7fffffff,
+    };
+
+    /**
+        @structure ToneMapping
+        Describes the contrast stretch of IR images to Y8. The pixels below the low
+        percentile map to 0, the pixels above the high percentile map to 255, and the
+        pixels in between are stretched linearly. The limits of a frame are blended
+        with the limits of the previous frame, so the structure carries the state of
+        a stream from frame to frame.
+    */
+    struct ToneMapping {
+        pxcF32  lowPercentile;      /* the percentage of the pixels mapped to 0 */
+        pxcF32  highPercentile;     /* the percentage of the pixels mapped below 255 */
+        pxcF32  smoothing;          /* the weight of the previous limits in [0,1); zero disables temporal smoothing */
+        pxcF32  low;                /* the low limit of the last frame in source units; negative before the first frame */
+        pxcF32  high;               /* the high limit of the last frame in source units */
+        pxcI32  reserved[3];
+    };
+
+    /**
+        @brief Initialize the tone mapping parameters to a 1-99 percentile stretch
+        without temporal smoothing, and clear the limits.
+        @param[out] toneMapping     The tone mapping, to be returned.
+    */
+    static void InitToneMapping(ToneMapping *toneMapping) {
+        memset(toneMapping, 0, sizeof(*toneMapping));
+        toneMapping->lowPercentile = 1;
+        toneMapping->highPercentile = 99;
+        toneMapping->low = toneMapping->high = -1;
+    }
+
+    /**
+        @brief Return the instruction sets the kernels are currently dispatched to.
+        @return a bit-OR'ed value of CpuFeature.
+    */
+    static pxcI32 QueryCpuFeatures(void);
+
+    /**
+        @brief Restrict kernel dispatch to a subset of the supported instruction sets,
+        for example CPU_FEATURE_NONE to run the scalar reference kernels.
+        @param[in] features     A bit-OR'ed value of CpuFeature.
+        @return the instruction sets the kernels are dispatched to.
+    */
+    static pxcI32 SetCpuFeatures(pxcI32 features);
+
+    /**
+        @brief Check if a conversion between two pixel formats is supported.
+        @param[in] src          The source pixel format.
+        @param[in] dst          The destination pixel format.
+        @return true if the conversion is supported.
+    */
+    static bool IsSupported(PXCImage::PixelFormat src, PXCImage::PixelFormat dst);
+
+    /**
+        @brief Convert image data between pixel formats. The formats are taken from the
+        format fields of the source and destination image data.
+        @param[in] src          The source image data.
+        @param[in] dst          The destination image data.
+        @param[in] width        The image width in pixels.
+        @param[in] height       The image height in pixels.
+        @param[in] depthUnit    The DEPTH_RAW unit in micrometers, see PXCCapture::Device::QueryDepthUnit.
+        @param[in,out] toneMapping  Optional, the tone mapping of Y16 and Y8_IR_RELATIVE to Y8, see ToneMap.
+        @return PXC_STATUS_NO_ERROR             Successful execution.
+        @return PXC_STATUS_PARAM_UNSUPPORTED    Unsupported conversion.
+        @return PXC_STATUS_ALLOC_FAILED         Failed to allocate the intermediate rows.
+    */
+    static pxcStatus Convert(const PXCImage::ImageData *src, PXCImage::ImageData *dst, pxcI32 width, pxcI32 height, pxcF32 depthUnit=1000, ToneMapping *toneMapping=0);
+
+    /**
+        @brief Contrast stretch a Y16 or Y8_IR_RELATIVE image to Y8. One pass builds the
+        histogram of the source, and a second pass maps the pixels between the percentile
+        limits to the 8-bit range. Y16 histograms have 4096 bins of 16 values.
+        @param[in] src          The source image data.
+        @param[out] dst         The Y8 destination image data.
+        @param[in] width        The image width in pixels.
+        @param[in] height       The image height in pixels.
+        @param[in,out] toneMapping  The tone mapping; the limits are updated with the limits of this image.
+        NULL stretches with the default parameters of InitToneMapping.
+        @return PXC_STATUS_NO_ERROR             Successful execution.
+        @return PXC_STATUS_PARAM_UNSUPPORTED    Unsupported format or parameters.
+        @return PXC_STATUS_ALLOC_FAILED         Failed to allocate the histogram.
+    */
+    static pxcStatus ToneMap(const PXCImage::ImageData *src, PXCImage::ImageData *dst, pxcI32 width, pxcI32 height, ToneMapping *toneMapping);
+
+    /**
+        @brief Convert an array of depth values among DEPTH_RAW, DEPTH and DEPTH_F32.
+        DEPTH and DEPTH_F32 are in millimeters and DEPTH_RAW in depthUnit micrometers.
+        The invalid depth value zero stays zero. NaN and non-positive DEPTH_F32 values
+        convert to zero, and values beyond the 16-bit range saturate to 65535.
+        @param[in] srcFormat    The source pixel format.
+        @param[in] src          The source depth values.
+        @param[in] dstFormat    The destination pixel format.
+        @param[out] dst         The destination depth values, to be returned.
+        @param[in] count        The number of depth values.
+        @param[in] depthUnit    The DEPTH_RAW unit in micrometers.
+        @return PXC_STATUS_NO_ERROR             Successful execution.
+        @return PXC_STATUS_PARAM_UNSUPPORTED    Unsupported format or depth unit.
+    */
+    static pxcStatus ConvertDepth(PXCImage::PixelFormat srcFormat, const void *src, PXCImage::PixelFormat dstFormat, void *dst, pxcI32 count, pxcF32 depthUnit);
+};
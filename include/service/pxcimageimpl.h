@@ -0,0 +1,1365 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcimageimpl.h
+    Defines PXCImageImpl, an implementation of the PXCImage interface over
+    system memory, and PXCImagePool, a session-level pool that recycles
+    images of the same ImageInfo instead of freeing them.
+ */
+#pragma once
+#include "pxcimage.h"
+#include "pxcmetadata.h"
+#include "pxcimagepyramid.h"
+#include "service/pxcimageconversion.h"
+#include "service/pxcimagerotation.h"
+#include "service/pxcimagescaling.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <malloc.h>
+#elif defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+class PXCImagePool;
+
+/**
+    This class holds the planes of an image in reference counted storage, either
+    allocated by the storage or adopted from the application. Images share storage
+    by reference; the storage is freed, or handed back through the release callback,
+    when the last reference is released.
+
+    Allocated planes start on PLANE_ALIGNMENT boundaries and their rows are padded
+    to ROW_ALIGNMENT bytes, as reported by ImageData::alignment. Planes of at least
+    HUGE_PAGE_SIZE bytes can be backed by huge pages, see SetHugePages. On Linux,
+    allocated planes can be bound to a NUMA node.
+*/
+class PXCImageStorage {
+public:
+    PXC_DEFINE_CONST(ROW_ALIGNMENT, 64);
+    PXC_DEFINE_CONST(PLANE_ALIGNMENT, 4096);
+    PXC_DEFINE_CONST(HUGE_PAGE_SIZE, 2<<20);
+    PXC_DEFINE_CONST(MAX_NUMA_NODES, 1024);
+
+    /**
+        @enum HugePages
+        Describes how large image buffers are backed by huge pages.
+    */
+    enum HugePages {
+        HUGE_PAGES_NONE         = 0,    /* regular pages */
+        HUGE_PAGES_TRANSPARENT  = 1,    /* advise the kernel to use transparent huge pages (default) */
+        HUGE_PAGES_EXPLICIT     = 2,    /* map image storage from the huge page pool, with transparent huge pages as fallback */
+    };
+
+    /**
+        @brief The callback that returns adopted planes to the application.
+        @param[in]  data            The adopted image data.
+        @param[in]  context         The context passed to Adopt.
+    */
+    typedef void (PXCAPI *ReleaseCallback)(PXCImage::ImageData *data, void *context);
+
+    /**
+        @brief Return the plane layout of a pixel format.
+        @param[in]  format          The pixel format.
+        @param[in]  width           The image width in pixels.
+        @param[in]  height          The image height in pixels.
+        @param[out] rowBytes        The number of bytes of one row in each plane, to be returned.
+        @param[out] heights         The number of rows in each plane, to be returned.
+        @return the number of planes, or zero if the format is not supported.
+    */
+    static pxcI32 QueryPlaneLayout(PXCImage::PixelFormat format, pxcI32 width, pxcI32 height, pxcI32 rowBytes[PXCImage::NUM_OF_PLANES], pxcI32 heights[PXCImage::NUM_OF_PLANES]) {
+        for (int i = 0; i < PXCImage::NUM_OF_PLANES; i++) rowBytes[i] = heights[i] = 0;
+        heights[0] = height;
+        switch (format) {
+        case PXCImage::PIXEL_FORMAT_YUY2:             rowBytes[0] = ((width + 1) & ~1) * 2; return 1;
+        case PXCImage::PIXEL_FORMAT_NV12:
+            rowBytes[0] = width;
+            rowBytes[1] = (width + 1) & ~1;
+            heights[1] = (height + 1) / 2;
+            return 2;
+        case PXCImage::PIXEL_FORMAT_RGB32:            rowBytes[0] = width * 4; return 1;
+        case PXCImage::PIXEL_FORMAT_RGB24:            rowBytes[0] = width * 3; return 1;
+        case PXCImage::PIXEL_FORMAT_Y8:
+        case PXCImage::PIXEL_FORMAT_Y8_IR_RELATIVE:   rowBytes[0] = width; return 1;
+        case PXCImage::PIXEL_FORMAT_DEPTH:
+        case PXCImage::PIXEL_FORMAT_DEPTH_RAW:
+        case PXCImage::PIXEL_FORMAT_Y16:              rowBytes[0] = width * 2; return 1;
+        case PXCImage::PIXEL_FORMAT_DEPTH_F32:        rowBytes[0] = width * 4; return 1;
+        default:
+            heights[0] = 0;
+            return 0;
+        }
+    }
+
+    /**
+        @brief Set how large image buffers are backed by huge pages. Huge pages are used on
+        Linux only; the setting applies to subsequent allocations.
+        @param[in]  mode            The huge page mode.
+    */
+    static void SetHugePages(HugePages mode) { HugePageMode() = mode; }
+
+    /**
+        @brief Return the huge page mode.
+    */
+    static HugePages QueryHugePages(void) { return (HugePages)HugePageMode().load(); }
+
+    /**
+        @brief Allocate a PLANE_ALIGNMENT aligned buffer.
+        @param[in]  size            The buffer size in bytes.
+        @return the buffer to free with FreeBuffer, or NULL if the allocation failed.
+    */
+    static pxcBYTE *AllocBuffer(size_t size) {
+#if defined(_WIN32) || defined(_WIN64)
+        return (pxcBYTE*)_aligned_malloc(size, PLANE_ALIGNMENT);
+#else
+        void *buffer = 0;
+        size_t alignment = PLANE_ALIGNMENT;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        /* whole huge pages, so the kernel can back the buffer without splitting pages */
+        bool huge = (size >= (size_t)HUGE_PAGE_SIZE && QueryHugePages() != HUGE_PAGES_NONE);
+        if (huge) {
+            alignment = HUGE_PAGE_SIZE;
+            size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+        }
+#endif
+        if (posix_memalign(&buffer, alignment, size)) return 0;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (huge) madvise(buffer, size, MADV_HUGEPAGE);
+#endif
+        return (pxcBYTE*)buffer;
+#endif
+    }
+
+    /**
+        @brief Free a buffer allocated by AllocBuffer or AllocPlanes.
+    */
+    static void FreeBuffer(pxcBYTE *buffer) {
+#if defined(_WIN32) || defined(_WIN64)
+        _aligned_free(buffer);
+#else
+        free(buffer);
+#endif
+    }
+
+    /**
+        @brief Return the largest power of two, up to PLANE_ALIGNMENT, that divides the plane
+        pointers and pitches of image data.
+        @param[in]  data            The image data.
+        @return the alignment in bytes.
+    */
+    static pxcI32 QueryAlignment(const PXCImage::ImageData &data) {
+        size_t bits = PLANE_ALIGNMENT;
+        for (int p = 0; p < PXCImage::NUM_OF_PLANES; p++) {
+            if (!data.planes[p]) continue;
+            bits |= (size_t)data.planes[p] | (size_t)data.pitches[p];
+        }
+        return (pxcI32)(bits & (~bits + 1));
+    }
+
+    /**
+        @brief Allocate contiguous planes of the specified format and size, with rows padded
+        to ROW_ALIGNMENT bytes and planes aligned to PLANE_ALIGNMENT bytes.
+        @param[in]  format          The pixel format.
+        @param[in]  width           The image width in pixels.
+        @param[in]  height          The image height in pixels.
+        @param[out] data            The plane pointers and pitches, to be returned.
+        @param[out] size            Optional, the number of allocated bytes, to be returned.
+        @return the buffer to free with FreeBuffer, or NULL if the allocation failed.
+    */
+    static pxcBYTE *AllocPlanes(PXCImage::PixelFormat format, pxcI32 width, pxcI32 height, PXCImage::ImageData *data, size_t *size) {
+        size_t offsets[PXCImage::NUM_OF_PLANES];
+        size_t total = LayoutPlanes(format, width, height, data, offsets);
+        if (size) *size = 0;
+        if (!total) return 0;
+        pxcBYTE *buffer = AllocBuffer(total);
+        if (!buffer) return 0;
+        SetPlanes(buffer, offsets, data);
+        if (size) *size = total;
+        return buffer;
+    }
+
+    /**
+        @brief Bind the pages of a buffer to a NUMA node, moving the pages already touched.
+        NUMA binding is supported on Linux only.
+        @param[in]  buffer          The buffer, aligned to PLANE_ALIGNMENT.
+        @param[in]  size            The buffer size in bytes, a multiple of PLANE_ALIGNMENT.
+        @param[in]  node            The NUMA node.
+        @return true if the buffer is bound to the node.
+    */
+    static bool BindNode(void *buffer, size_t size, pxcI32 node) {
+#if defined(__linux__)
+        const size_t BITS = 8 * sizeof(unsigned long);
+        unsigned long nodes[MAX_NUMA_NODES / BITS] = { 0 };
+        if (!buffer || node < 0 || node >= MAX_NUMA_NODES) return false;
+        nodes[node / BITS] |= 1ul << (node % BITS);
+        return !syscall(SYS_mbind, buffer, size, MPOL_BIND, nodes, (unsigned long)MAX_NUMA_NODES + 1, MPOL_MF_MOVE);
+#else
+        return false;
+#endif
+    }
+
+    /**
+        @brief Create storage with its own planes.
+        @param[in]  info            The image format and size.
+        @param[in]  node            Optional, the NUMA node to bind the planes to, or -1 for any node.
+        @return the storage with one reference, or NULL if the allocation failed.
+    */
+    static PXCImageStorage *Alloc(const PXCImage::ImageInfo &info, pxcI32 node = -1) {
+        PXCImageStorage *storage = new PXCImageStorage();
+        size_t offsets[PXCImage::NUM_OF_PLANES];
+        size_t total = LayoutPlanes(info.format, info.width, info.height, &storage->data, offsets);
+#if defined(__linux__) && defined(MAP_HUGETLB)
+        if (total >= (size_t)HUGE_PAGE_SIZE && QueryHugePages() == HUGE_PAGES_EXPLICIT) {
+            size_t mapped = (total + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+            void *buffer = mmap(0, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (buffer != MAP_FAILED) {
+                storage->buffer = (pxcBYTE*)buffer;
+                storage->mapped = mapped;
+            }
+        }
+#endif
+        if (!storage->buffer && total) storage->buffer = AllocBuffer(total);
+        if (!storage->buffer) {
+            delete storage;
+            return 0;
+        }
+        storage->size = total;
+        SetPlanes(storage->buffer, offsets, &storage->data);
+        if (node >= 0) BindNode(storage->buffer, storage->mapped ? storage->mapped : total, node);
+        return storage;
+    }
+
+    /**
+        @brief Create storage that references application planes without copying them.
+        @param[in]  data            The planes and pitches to adopt.
+        @param[in]  release         Optional, the callback invoked when the last reference is released.
+        @param[in]  context         The callback context.
+        @return the storage with one reference.
+    */
+    static PXCImageStorage *Adopt(const PXCImage::ImageData &data, ReleaseCallback release, void *context) {
+        PXCImageStorage *storage = new PXCImageStorage();
+        storage->data = data;
+        storage->data.alignment = QueryAlignment(data);
+        storage->release = release;
+        storage->context = context;
+        return storage;
+    }
+
+    /**
+        @brief Create storage that references a region of the planes of other storage.
+        @param[in]  parent          The storage that holds the planes.
+        @param[in]  data            The planes and pitches of the region.
+        @return the storage with one reference; it references the parent storage.
+    */
+    static PXCImageStorage *View(PXCImageStorage *parent, const PXCImage::ImageData &data) {
+        PXCImageStorage *storage = Adopt(data, 0, 0);
+        parent->AddRef();
+        storage->parent = parent;
+        return storage;
+    }
+
+    pxcI32 AddRef(void) { return ++refCount; }
+
+    void Release(void) {
+        if (!--refCount) delete this;
+    }
+
+    /**
+        @brief Return the number of references, which is one for unshared storage.
+    */
+    pxcI32 QueryRefCount(void) { return refCount; }
+
+    /**
+        @brief Check if other storage or images reference the planes. Images copy shared
+        storage before writing to it.
+    */
+    bool IsShared(void) { return refCount > 1 || (parent && parent->IsShared()); }
+
+    /**
+        @brief Return the planes and pitches of the storage.
+    */
+    const PXCImage::ImageData &QueryData(void) { return data; }
+
+    /**
+        @brief Return the number of bytes allocated by the storage, zero for adopted planes.
+    */
+    size_t QuerySize(void) { return size; }
+
+protected:
+
+    static std::atomic<int> &HugePageMode(void) {
+        static std::atomic<int> mode(HUGE_PAGES_TRANSPARENT);
+        return mode;
+    }
+
+    /* Compute the padded plane layout; return the total size in bytes, zero for unsupported formats. */
+    static size_t LayoutPlanes(PXCImage::PixelFormat format, pxcI32 width, pxcI32 height, PXCImage::ImageData *data, size_t offsets[PXCImage::NUM_OF_PLANES]) {
+        pxcI32 rowBytes[PXCImage::NUM_OF_PLANES], heights[PXCImage::NUM_OF_PLANES];
+        pxcI32 nplanes = QueryPlaneLayout(format, width, height, rowBytes, heights);
+        memset(data, 0, sizeof(*data));
+        data->format = format;
+        size_t total = 0;
+        for (pxcI32 p = 0; p < nplanes; p++) {
+            data->pitches[p] = (rowBytes[p] + ROW_ALIGNMENT - 1) & ~(ROW_ALIGNMENT - 1);
+            offsets[p] = total;
+            total += ((size_t)data->pitches[p] * heights[p] + PLANE_ALIGNMENT - 1) & ~(size_t)(PLANE_ALIGNMENT - 1);
+        }
+        return total;
+    }
+
+    static void SetPlanes(pxcBYTE *buffer, const size_t offsets[PXCImage::NUM_OF_PLANES], PXCImage::ImageData *data) {
+        for (pxcI32 p = 0; p < PXCImage::NUM_OF_PLANES; p++)
+            if (data->pitches[p]) data->planes[p] = buffer + offsets[p];
+        data->alignment = ROW_ALIGNMENT;
+    }
+
+    PXCImageStorage(void):refCount(1),buffer(0),size(0),mapped(0),release(0),context(0),parent(0) {
+        memset(&data, 0, sizeof(data));
+    }
+
+    ~PXCImageStorage(void) {
+        if (release) release(&data, context);
+        if (parent) parent->Release();
+#if defined(__linux__)
+        if (mapped) {
+            munmap(buffer, mapped);
+            return;
+        }
+#endif
+        if (buffer) FreeBuffer(buffer);
+    }
+
+    std::atomic<int>        refCount;
+    PXCImage::ImageData     data;
+    pxcBYTE                 *buffer;
+    size_t                  size;
+    size_t                  mapped;     /* the size of a huge page mapping, zero for heap buffers */
+    ReleaseCallback         release;
+    void                    *context;
+    PXCImageStorage         *parent;    /* the storage of the planes of a view */
+};
+
+/**
+    This class implements the PXCImage, PXCMetadata, PXCImagePyramid and PXCAddRef interfaces
+    for images stored in system memory. Create instances through
+    PXCImagePool::CreateImage.
+*/
+class PXCImageImpl:public PXCAddRefImpl<PXCBaseImplN<PXCImage,PXCMetadata,PXCImagePyramid> > {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('I','M','G','S'));
+
+    virtual void* PXCAPI QueryInstance(pxcUID cuid) {
+        if (cuid == CUID) return this;
+        return PXCAddRefImpl<PXCBaseImplN<PXCImage,PXCMetadata,PXCImagePyramid> >::QueryInstance(cuid);
+    }
+
+    /**
+        @brief Copy the planes of one image buffer to another of the same format and size.
+        @param[in]  src             The source image data.
+        @param[in]  dst             The destination image data.
+        @param[in]  info            The image format and size.
+        @return PXC_STATUS_NO_ERROR         Successful execution.
+        @return PXC_STATUS_PARAM_UNSUPPORTED Unsupported pixel format.
+    */
+    static pxcStatus CopyPlanes(const ImageData *src, ImageData *dst, const ImageInfo &info) {
+        pxcI32 rowBytes[NUM_OF_PLANES], heights[NUM_OF_PLANES];
+        pxcI32 nplanes = PXCImageStorage::QueryPlaneLayout(info.format, info.width, info.height, rowBytes, heights);
+        if (!nplanes) return PXC_STATUS_PARAM_UNSUPPORTED;
+        for (pxcI32 p = 0; p < nplanes; p++) {
+            if (!src->planes[p] || !dst->planes[p]) return PXC_STATUS_HANDLE_INVALID;
+            if (src->planes[p] == dst->planes[p]) continue;
+            if (src->pitches[p] == dst->pitches[p] && src->pitches[p] >= rowBytes[p]) {
+                memcpy(dst->planes[p], src->planes[p], (size_t)src->pitches[p] * (heights[p] - 1) + rowBytes[p]);
+                continue;
+            }
+            for (pxcI32 y = 0; y < heights[p]; y++)
+                memcpy(dst->planes[p] + (size_t)y * dst->pitches[p], src->planes[p] + (size_t)y * src->pitches[p], rowBytes[p]);
+        }
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /**
+        @brief Create an image that wraps application owned image data without copying it.
+        Without a release callback, the application must maintain the life cycle of the image
+        data. See PXCSession::CreateImage.
+        @param[in]  info            The format and resolution of the image.
+        @param[in]  data            The image data.
+        @param[in]  release         Optional, the callback invoked when the image no longer references the data.
+        @param[in]  context         The callback context.
+    */
+    PXCImageImpl(const ImageInfo &info, const ImageData &data, PXCImageStorage::ReleaseCallback release=0, void *context=0) {
+        Init(info);
+        SetStorage(PXCImageStorage::Adopt(data, release, context));
+    }
+
+    virtual ~PXCImageImpl(void) {
+        FreeConversions();
+        if (storage) storage->Release();
+        if (parent) parent->Release();
+    }
+
+    /**
+        @brief Create an image over a rectangle of this image without copying the planes.
+        The view keeps this image alive and shares its planes until either image is
+        written; the written image then copies its planes, so writes are not visible
+        through the other image. The view starts with the time stamp, stream type,
+        options and depth unit of this image, and no metadata.
+        @param[in]  rect            The region in pixels. NV12 regions start at even
+                                    coordinates, and YUY2 regions at even columns.
+        @return the view with one reference, or NULL if the region is invalid or the
+        image is being written.
+    */
+    PXCImage *CreateView(const PXCRectI32 &rect) {
+        if (rect.x < 0 || rect.y < 0 || rect.w <= 0 || rect.h <= 0 || rect.x > info.width - rect.w || rect.y > info.height - rect.h) return 0;
+        if ((info.format == PIXEL_FORMAT_NV12 || info.format == PIXEL_FORMAT_YUY2) && (rect.x & 1)) return 0;
+        if (info.format == PIXEL_FORMAT_NV12 && (rect.y & 1)) return 0;
+
+        std::lock_guard<std::mutex> lock(accessMutex);
+        if (writers || !storage) return 0;
+        /* the plane layout of an image of the size of the offset gives the byte offsets */
+        pxcI32 offsets[NUM_OF_PLANES], rows[NUM_OF_PLANES];
+        pxcI32 nplanes = PXCImageStorage::QueryPlaneLayout(info.format, rect.x, rect.y, offsets, rows);
+        if (!nplanes) return 0;
+        ImageData view = data;
+        for (pxcI32 p = 0; p < nplanes; p++)
+            view.planes[p] = data.planes[p] + (size_t)rows[p] * data.pitches[p] + offsets[p];
+
+        ImageInfo view_info = info;
+        view_info.width = rect.w;
+        view_info.height = rect.h;
+        PXCImageImpl *image = new PXCImageImpl(view_info, PXCImageStorage::View(storage, view), this);
+        image->timeStamp = timeStamp;
+        image->streamType = streamType;
+        image->options = options;
+        image->depthUnit = depthUnit;
+        return image;
+    }
+
+    /**
+        @brief Return the image a view was created from, or NULL. The reference is not added.
+    */
+    PXCImage *QueryParent(void) { return parent; }
+
+    /**
+        @brief Return the number of bytes of image storage allocated by this instance.
+    */
+    size_t QueryBufferSize(void) { return bufferSize; }
+
+    /**
+        @brief Replace the image planes with application planes without copying them. The image
+        references the planes until it is released or adopts other planes; the release callback
+        is then invoked. There must be no outstanding access to the image.
+        @param[in]  data            The planes and pitches to adopt, in the native pixel format.
+        @param[in]  release         Optional, the callback invoked when the image no longer references the data.
+        @param[in]  context         The callback context.
+        @return PXC_STATUS_NO_ERROR         Successful execution.
+        @return PXC_STATUS_HANDLE_INVALID   Missing planes.
+        @return PXC_STATUS_PARAM_UNSUPPORTED The pixel format does not match.
+        @return PXC_STATUS_DEVICE_BUSY      The image is being accessed.
+    */
+    pxcStatus AdoptData(const ImageData *data, PXCImageStorage::ReleaseCallback release, void *context) {
+        if (!data) return PXC_STATUS_HANDLE_INVALID;
+        if (data->format && data->format != info.format) return PXC_STATUS_PARAM_UNSUPPORTED;
+        pxcI32 rowBytes[NUM_OF_PLANES], heights[NUM_OF_PLANES];
+        pxcI32 nplanes = PXCImageStorage::QueryPlaneLayout(info.format, info.width, info.height, rowBytes, heights);
+        for (pxcI32 p = 0; p < nplanes; p++)
+            if (!data->planes[p]) return PXC_STATUS_HANDLE_INVALID;
+
+        PXCImageStorage *previous;
+        {
+            std::lock_guard<std::mutex> lock(accessMutex);
+            if (IsAccessedLocked()) return PXC_STATUS_DEVICE_BUSY;
+            InvalidateLocked();
+            previous = storage;
+            SetStorage(PXCImageStorage::Adopt(*data, release, context));
+        }
+        /* the release callback of the previous planes runs without the lock */
+        if (previous) previous->Release();
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /**
+        @brief Set the unit of DEPTH_RAW values, used to convert to and from the millimeter
+        depth formats in AcquireAccess. The default is 1000 (one millimeter).
+        @param[in]  depthUnit       The depth unit in micrometers, see PXCCapture::Device::QueryDepthUnit.
+        @return PXC_STATUS_NO_ERROR         Successful execution.
+        @return PXC_STATUS_PARAM_UNSUPPORTED The depth unit is not positive.
+    */
+    pxcStatus SetDepthUnit(pxcF32 depthUnit) {
+        if (!(depthUnit > 0)) return PXC_STATUS_PARAM_UNSUPPORTED;
+        this->depthUnit = depthUnit;
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /**
+        @brief Return the unit of DEPTH_RAW values in micrometers.
+    */
+    pxcF32 QueryDepthUnit(void) { return depthUnit; }
+
+    virtual ImageInfo PXCAPI QueryInfo(void) { return info; }
+    virtual pxcI64    PXCAPI QueryTimeStamp(void) { return timeStamp; }
+    virtual pxcEnum   PXCAPI QueryStreamType(void) { return streamType; }
+    virtual Option    PXCAPI QueryOptions(void) { return options; }
+    virtual void      PXCAPI SetTimeStamp(pxcI64 ts) { timeStamp = ts; }
+    virtual void      PXCAPI SetStreamType(pxcEnum streamType) { this->streamType = streamType; }
+    virtual void      PXCAPI SetOptions(Option options) { this->options = options; }
+
+    /* An image of the same format and size shares the planes of the source; the
+       planes are copied when either image is written. A PXCImageImpl source that is
+       being written returns PXC_STATUS_DEVICE_BUSY instead of a partial copy. */
+    virtual pxcStatus PXCAPI CopyImage(PXCImage *src_image) {
+        if (!src_image) return PXC_STATUS_HANDLE_INVALID;
+        ImageInfo src_info = src_image->QueryInfo();
+        if (src_info.width != info.width || src_info.height != info.height) return PXC_STATUS_PARAM_UNSUPPORTED;
+
+        PXCImageImpl *src_impl = src_image->QueryInstance<PXCImageImpl>();
+        if (src_impl) {
+            PXCImageStorage *shared = 0;
+            pxcStatus sts = src_impl->ShareStorage(src_info.format == info.format ? &shared : 0);
+            if (sts < PXC_STATUS_NO_ERROR) return sts;
+            if (shared) {
+                std::lock_guard<std::mutex> lock(accessMutex);
+                InvalidateLocked();
+                PXCImageStorage *previous = storage;
+                SetStorage(shared);
+                if (previous) previous->Release();
+                return PXC_STATUS_NO_ERROR;
+            }
+        }
+
+        ImageData src_data;
+        pxcStatus sts = src_image->AcquireAccess(ACCESS_READ, info.format, &src_data);
+        if (sts < PXC_STATUS_NO_ERROR) return sts;
+        {
+            std::lock_guard<std::mutex> lock(accessMutex);
+            sts = DetachStorageLocked();
+            InvalidateLocked();
+            if (sts >= PXC_STATUS_NO_ERROR) sts = CopyPlanes(&src_data, &data, info);
+        }
+        src_image->ReleaseAccess(&src_data);
+        return sts;
+    }
+
+    virtual pxcStatus PXCAPI ExportData(ImageData *dst, pxcEnum /*flags*/) {
+        if (!dst) return PXC_STATUS_HANDLE_INVALID;
+        if (dst->format && dst->format != info.format) return PXC_STATUS_PARAM_UNSUPPORTED;
+        return CopyPlanes(&data, dst, info);
+    }
+
+    virtual pxcStatus PXCAPI ImportData(ImageData *src, pxcEnum flags) {
+        if (!src) return PXC_STATUS_HANDLE_INVALID;
+        if (flags & IMPORT_FLAG_ADOPT) return AdoptData(src, 0, 0);
+        if (src->format && src->format != info.format) return PXC_STATUS_PARAM_UNSUPPORTED;
+        std::lock_guard<std::mutex> lock(accessMutex);
+        pxcStatus sts = DetachStorageLocked();
+        if (sts < PXC_STATUS_NO_ERROR) return sts;
+        InvalidateLocked();
+        return CopyPlanes(src, &data, info);
+    }
+
+    /* Read access in a pixel format other than the native one, or with a rotation, is
+       served from a cache of converted planes shared by all readers; the cache is
+       invalidated by any write. Write access in another format converts into a temporary
+       buffer and converts it back on ReleaseAccess. Rotated access is read only; the
+       returned planes have the rotated width and height. Y8 access to Y16 and
+       Y8_IR_RELATIVE images is read only and contrast stretched, see
+       PXCImagePool::SetToneMapping. Native access is tagged in the reserved fields of the
+       returned image data, which ReleaseAccess uses to tell readers from writers. */
+    virtual pxcStatus PXCAPI AcquireAccess(Access access, PixelFormat format, Option options, ImageData *data) {
+        if (!data) return PXC_STATUS_HANDLE_INVALID;
+        if (!(access & ACCESS_READ_WRITE)) return PXC_STATUS_PARAM_UNSUPPORTED;
+        Rotation rotation = (Rotation)((pxcI32)options & ROTATION_OPTION_MASK);
+        if ((pxcI32)options & ~ROTATION_OPTION_MASK) return PXC_STATUS_PARAM_UNSUPPORTED;
+        if (rotation != ROTATION_0_DEGREE && rotation != ROTATION_90_DEGREE && rotation != ROTATION_180_DEGREE && rotation != ROTATION_270_DEGREE)
+            return PXC_STATUS_PARAM_UNSUPPORTED;
+        if (!format) format = info.format;
+        if (format == info.format && !rotation) {
+            std::lock_guard<std::mutex> lock(accessMutex);
+            if (access & ACCESS_WRITE) {
+                pxcStatus sts = DetachStorageLocked();
+                if (sts < PXC_STATUS_NO_ERROR) return sts;
+                writers++;
+                InvalidateLocked();
+            } else {
+                readers++;
+            }
+            *data = this->data;
+            data->reserved[0] = access;
+            data->reserved[1] = uid;
+            return PXC_STATUS_NO_ERROR;
+        }
+        if (format != info.format && !PXCImageConversion::IsSupported(info.format, format)) return PXC_STATUS_PARAM_UNSUPPORTED;
+        if ((access & ACCESS_WRITE) && format != info.format && !PXCImageConversion::IsSupported(format, info.format)) return PXC_STATUS_PARAM_UNSUPPORTED;
+        if (rotation && ((access & ACCESS_WRITE) || !PXCImageRotation::IsSupported(format))) return PXC_STATUS_PARAM_UNSUPPORTED;
+
+        /* Convert with the lock held so concurrent readers of one format share one conversion. */
+        std::lock_guard<std::mutex> lock(accessMutex);
+        bool cacheable = (access == ACCESS_READ && !writers);
+        Conversion *cached = cacheable ? FindCachedLocked(format, rotation) : 0;
+        if (cached) {
+            cached->users++;
+            cacheHits++;
+            *data = cached->data;
+            return PXC_STATUS_NO_ERROR;
+        }
+
+        /* the unrotated planes in the requested format */
+        ImageData source = this->data;
+        pxcBYTE *temporary = 0;
+        if (format != info.format) {
+            Conversion *base = rotation && cacheable ? FindCachedLocked(format, ROTATION_0_DEGREE) : 0;
+            if (base) {
+                source = base->data;
+            } else {
+                temporary = PXCImageStorage::AllocPlanes(format, info.width, info.height, &source, 0);
+                if (!temporary) return PXC_STATUS_ALLOC_FAILED;
+                if (access & ACCESS_READ) {
+                    pxcStatus sts = ConvertNative(&source);
+                    if (sts < PXC_STATUS_NO_ERROR) {
+                        PXCImageStorage::FreeBuffer(temporary);
+                        return sts;
+                    }
+                }
+            }
+        }
+
+        Conversion conversion;
+        conversion.access = access;
+        conversion.rotation = rotation;
+        conversion.level = 0;
+        conversion.filter = PXCImagePyramid::FILTER_DEFAULT;
+        conversion.users = 1;
+        conversion.cached = cacheable;
+        conversion.stale = false;
+        if (!rotation) {
+            conversion.data = source;
+            conversion.buffer = temporary;
+        } else {
+            pxcI32 width, height;
+            PXCImageRotation::QueryRotatedSize(info.width, info.height, rotation, &width, &height);
+            conversion.buffer = PXCImageStorage::AllocPlanes(format, width, height, &conversion.data, 0);
+            pxcStatus sts = conversion.buffer ? PXCImageRotation::Rotate(&source, &conversion.data, info.width, info.height, rotation) : PXC_STATUS_ALLOC_FAILED;
+            if (sts < PXC_STATUS_NO_ERROR) {
+                PXCImageStorage::FreeBuffer(conversion.buffer);
+                PXCImageStorage::FreeBuffer(temporary);
+                return sts;
+            }
+            /* keep the converted planes for readers of the unrotated format */
+            if (temporary && cacheable) {
+                Conversion base = conversion;
+                base.rotation = ROTATION_0_DEGREE;
+                base.users = 0;
+                base.data = source;
+                base.buffer = temporary;
+                conversions.push_back(base);
+            } else if (temporary) {
+                PXCImageStorage::FreeBuffer(temporary);
+            }
+        }
+        if (access == ACCESS_READ) cacheMisses++;
+        if (access & ACCESS_WRITE) InvalidateLocked();
+        conversions.push_back(conversion);
+        *data = conversion.data;
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    virtual pxcStatus PXCAPI ReleaseAccess(ImageData *data) {
+        if (!data) return PXC_STATUS_HANDLE_INVALID;
+        std::lock_guard<std::mutex> lock(accessMutex);
+        std::vector<Conversion>::iterator it = conversions.begin();
+        while (it != conversions.end() && it->data.planes[0] != data->planes[0]) ++it;
+        if (it == conversions.end()) {
+            if (data->reserved[1] != uid) return PXC_STATUS_NO_ERROR;
+            if (data->reserved[0] & ACCESS_WRITE) {
+                if (writers > 0) writers--;
+                InvalidateLocked();
+            } else if (readers > 0) {
+                readers--;
+            }
+            data->reserved[0] = data->reserved[1] = 0;
+            return PXC_STATUS_NO_ERROR;
+        }
+
+        pxcStatus sts = PXC_STATUS_NO_ERROR;
+        if (it->access & ACCESS_WRITE) {
+            sts = DetachStorageLocked();
+            if (sts >= PXC_STATUS_NO_ERROR)
+                sts = PXCImageConversion::Convert(&it->data, &this->data, info.width, info.height, depthUnit);
+            InvalidateLocked();
+        }
+        if (!--it->users && (!it->cached || it->stale)) {
+            PXCImageStorage::FreeBuffer(it->buffer);
+            conversions.erase(it);
+        }
+        return sts;
+    }
+
+    virtual pxcI32 PXCAPI QueryLevels(void) {
+        pxcI32 levels = 1;
+        for (pxcI32 width = info.width, height = info.height; width > 1 || height > 1; levels++)
+            PXCImageScaling::QueryHalfSize(width, height, &width, &height);
+        return levels;
+    }
+
+    virtual ImageInfo PXCAPI QueryLevelInfo(pxcI32 level) {
+        ImageInfo level_info = info;
+        if (level < 0 || level >= QueryLevels()) {
+            level_info.width = level_info.height = 0;
+            return level_info;
+        }
+        for (pxcI32 l = 0; l < level; l++)
+            PXCImageScaling::QueryHalfSize(level_info.width, level_info.height, &level_info.width, &level_info.height);
+        return level_info;
+    }
+
+    /* Levels share the conversion cache: each level is downscaled from the nearest
+       cached level, and the intermediate levels are cached on the way. Level 0 is
+       the image itself, accessed through AcquireAccess. */
+    virtual pxcStatus PXCAPI AcquireLevelAccess(pxcI32 level, PixelFormat format, PXCImagePyramid::Filter filter, ImageData *data) {
+        if (!data) return PXC_STATUS_HANDLE_INVALID;
+        if (level < 0 || level >= QueryLevels()) return PXC_STATUS_ITEM_UNAVAILABLE;
+        if (!format) format = info.format;
+        if (!PXCImageScaling::IsSupported(format, filter)) return PXC_STATUS_PARAM_UNSUPPORTED;
+        if (!level) return AcquireAccess(ACCESS_READ, format, OPTION_ANY, data);
+        if (format != info.format && !PXCImageConversion::IsSupported(info.format, format)) return PXC_STATUS_PARAM_UNSUPPORTED;
+        if (!filter) filter = PXCImageScaling::QueryDefaultFilter(format);
+
+        std::lock_guard<std::mutex> lock(accessMutex);
+        bool cacheable = !writers;
+        Conversion *cached = cacheable ? FindCachedLocked(format, ROTATION_0_DEGREE, level, filter) : 0;
+        if (cached) {
+            cached->users++;
+            cacheHits++;
+            *data = cached->data;
+            return PXC_STATUS_NO_ERROR;
+        }
+
+        /* the nearest level to downscale from; temporary holds it if it is not cached */
+        ImageData source = this->data;
+        pxcBYTE *temporary = 0;
+        pxcI32 from = 0;
+        for (pxcI32 l = level - 1; cacheable && l > 0 && !from; l--) {
+            Conversion *c = FindCachedLocked(format, ROTATION_0_DEGREE, l, filter);
+            if (c) {
+                source = c->data;
+                from = l;
+            }
+        }
+        if (!from && format != info.format) {
+            Conversion *base = cacheable ? FindCachedLocked(format, ROTATION_0_DEGREE) : 0;
+            if (base) {
+                source = base->data;
+            } else {
+                temporary = PXCImageStorage::AllocPlanes(format, info.width, info.height, &source, 0);
+                if (!temporary) return PXC_STATUS_ALLOC_FAILED;
+                pxcStatus sts = ConvertNative(&source);
+                if (sts < PXC_STATUS_NO_ERROR) {
+                    PXCImageStorage::FreeBuffer(temporary);
+                    return sts;
+                }
+                if (cacheable) {
+                    Conversion converted = { ACCESS_READ, ROTATION_0_DEGREE, 0, PXCImagePyramid::FILTER_DEFAULT, source, temporary, 0, true, false };
+                    conversions.push_back(converted);
+                    temporary = 0;
+                }
+            }
+        }
+
+        ImageInfo source_info = QueryLevelInfo(from);
+        for (pxcI32 l = from + 1; l <= level; l++) {
+            Conversion conversion = { ACCESS_READ, ROTATION_0_DEGREE, l, filter, source, 0, (l == level) ? 1 : 0, cacheable, false };
+            pxcI32 width, height;
+            PXCImageScaling::QueryHalfSize(source_info.width, source_info.height, &width, &height);
+            conversion.buffer = PXCImageStorage::AllocPlanes(format, width, height, &conversion.data, 0);
+            pxcStatus sts = conversion.buffer ? PXCImageScaling::Downscale(&source, &conversion.data, source_info.width, source_info.height, filter) : PXC_STATUS_ALLOC_FAILED;
+            PXCImageStorage::FreeBuffer(temporary);
+            temporary = 0;
+            if (sts < PXC_STATUS_NO_ERROR) {
+                PXCImageStorage::FreeBuffer(conversion.buffer);
+                return sts;
+            }
+            source = conversion.data;
+            source_info.width = width;
+            source_info.height = height;
+            if (l == level || cacheable) conversions.push_back(conversion);
+            else temporary = conversion.buffer;
+        }
+        cacheMisses++;
+        *data = source;
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    virtual pxcStatus PXCAPI ReleaseLevelAccess(ImageData *data) {
+        return ReleaseAccess(data);
+    }
+
+    /**
+        @brief Return the conversion cache counters of this image.
+        @param[out] hits            The number of AcquireAccess calls served from the cache, to be returned.
+        @param[out] misses          The number of AcquireAccess calls that converted the image, to be returned.
+    */
+    void QueryConversionStatistics(pxcI64 *hits, pxcI64 *misses) {
+        std::lock_guard<std::mutex> lock(accessMutex);
+        if (hits) *hits = cacheHits;
+        if (misses) *misses = cacheMisses;
+    }
+
+    virtual pxcUID PXCAPI QueryUID(void) { return uid; }
+
+    virtual pxcUID PXCAPI QueryMetadata(pxcI32 idx) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idx < 0 || idx >= (pxcI32)metadata.size()) return 0;
+        Metadata::iterator it = metadata.begin();
+        std::advance(it, idx);
+        return it->first;
+    }
+
+    virtual pxcStatus PXCAPI DetachMetadata(pxcUID id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return metadata.erase(id) ? PXC_STATUS_NO_ERROR : PXC_STATUS_ITEM_UNAVAILABLE;
+    }
+
+    virtual pxcStatus PXCAPI AttachBuffer(pxcUID id, pxcBYTE *buffer, pxcI32 size) {
+        if (!buffer || size <= 0) return PXC_STATUS_HANDLE_INVALID;
+        std::lock_guard<std::mutex> lock(mutex);
+        metadata[id].assign(buffer, buffer + size);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    virtual pxcI32 PXCAPI QueryBufferSize(pxcUID id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Metadata::iterator it = metadata.find(id);
+        return (it == metadata.end()) ? 0 : (pxcI32)it->second.size();
+    }
+
+    virtual pxcStatus PXCAPI QueryBuffer(pxcUID id, pxcBYTE *buffer, pxcI32 size) {
+        if (!buffer) return PXC_STATUS_HANDLE_INVALID;
+        std::lock_guard<std::mutex> lock(mutex);
+        Metadata::iterator it = metadata.find(id);
+        if (it == metadata.end()) return PXC_STATUS_ITEM_UNAVAILABLE;
+        if (size > (pxcI32)it->second.size()) size = (pxcI32)it->second.size();
+        memcpy(buffer, &it->second[0], size);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    virtual pxcStatus PXCAPI AttachSerializable(pxcUID /*id*/, PXCBase* /*instance*/) {
+        return PXC_STATUS_FEATURE_UNSUPPORTED;
+    }
+
+    virtual pxcStatus PXCAPI CreateSerializable(pxcUID /*id*/, pxcUID /*cuid*/, void** /*instance*/) {
+        return PXC_STATUS_FEATURE_UNSUPPORTED;
+    }
+
+    /* The last reference returns a pooled image to its pool instead of deleting it. */
+    virtual void PXCAPI Release(void);
+
+protected:
+    friend class PXCImagePool;
+
+    typedef std::map<pxcUID, std::vector<pxcBYTE> > Metadata;
+
+    PXC_DEFINE_CONST(ROTATION_OPTION_MASK, 0x1ff);
+
+    /* A cached conversion, or an outstanding access in a non-native pixel format, rotation or pyramid level. */
+    struct Conversion {
+        Access      access;
+        Rotation    rotation;
+        pxcI32      level;      /* the pyramid level */
+        PXCImagePyramid::Filter filter; /* the downscaling filter of levels above 0 */
+        ImageData   data;
+        pxcBYTE     *buffer;
+        pxcI32      users;      /* outstanding accesses to the buffer */
+        bool        cached;     /* shared by read accesses of the same format */
+        bool        stale;      /* invalidated; freed when the last user releases */
+    };
+
+    /* Convert the native planes to another pixel format; called with accessMutex held. */
+    pxcStatus ConvertNative(ImageData *dst);
+
+    /* Drop the cached conversions; called with accessMutex held. */
+    void InvalidateLocked(void) {
+        for (size_t i = 0; i < conversions.size();) {
+            Conversion &c = conversions[i];
+            if (c.cached) c.stale = true;
+            if (c.cached && !c.users) {
+                PXCImageStorage::FreeBuffer(c.buffer);
+                conversions.erase(conversions.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    /* Find a valid cache entry; called with accessMutex held. */
+    Conversion *FindCachedLocked(PixelFormat format, Rotation rotation, pxcI32 level=0, PXCImagePyramid::Filter filter=PXCImagePyramid::FILTER_DEFAULT) {
+        for (size_t i = 0; i < conversions.size(); i++) {
+            Conversion &c = conversions[i];
+            if (c.cached && !c.stale && c.data.format == format && c.rotation == rotation && c.level == level && c.filter == filter) return &c;
+        }
+        return 0;
+    }
+
+    /* Check for outstanding accesses to the planes; called with accessMutex held. */
+    bool IsAccessedLocked(void) {
+        if (readers || writers) return true;
+        for (size_t i = 0; i < conversions.size(); i++)
+            if (conversions[i].users) return true;
+        return false;
+    }
+
+    /* Reference the planes for a copy of this image if shared is not NULL; fails while a writer holds them. */
+    pxcStatus ShareStorage(PXCImageStorage **shared) {
+        std::lock_guard<std::mutex> lock(accessMutex);
+        if (writers) return PXC_STATUS_DEVICE_BUSY;
+        if (shared && storage) {
+            storage->AddRef();
+            *shared = storage;
+        }
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /* Copy shared planes into storage of this image before a write; called with accessMutex held. */
+    pxcStatus DetachStorageLocked(void) {
+        if (!storage || !storage->IsShared()) return PXC_STATUS_NO_ERROR;
+        PXCImageStorage *copy = PXCImageStorage::Alloc(info, node);
+        if (!copy) return PXC_STATUS_ALLOC_FAILED;
+        ImageData dst = copy->QueryData();
+        CopyPlanes(&data, &dst, info);
+        PXCImageStorage *shared = storage;
+        SetStorage(copy);
+        shared->Release();
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /* Create an image with its own storage, bound to a NUMA node unless node is -1. */
+    PXCImageImpl(const ImageInfo &info, PXCImagePool *pool, pxcI32 node) {
+        Init(info);
+        this->pool = pool;
+        this->node = node;
+        SetStorage(PXCImageStorage::Alloc(info, node));
+        if (storage) bufferSize = storage->QuerySize();
+    }
+
+    /* Create a view over storage of the parent image. */
+    PXCImageImpl(const ImageInfo &info, PXCImageStorage *storage, PXCImageImpl *parent) {
+        Init(info);
+        SetStorage(storage);
+        parent->AddRef();
+        this->parent = parent;
+    }
+
+    /* Take over one reference of the storage and expose its planes. */
+    void SetStorage(PXCImageStorage *storage) {
+        this->storage = storage;
+        if (storage) data = storage->QueryData();
+        data.format = info.format;
+    }
+
+    void Init(const ImageInfo &info) {
+        static std::atomic<int> uids(1);
+        this->info = info;
+        memset(&data, 0, sizeof(data));
+        data.format = info.format;
+        storage = 0;
+        bufferSize = 0;
+        pool = 0;
+        node = -1;
+        parent = 0;
+        uid = uids++;
+        timeStamp = 0;
+        streamType = 0;
+        options = OPTION_ANY;
+        depthUnit = 1000;
+        readers = 0;
+        writers = 0;
+        cacheHits = 0;
+        cacheMisses = 0;
+    }
+
+    /* Clear the per-frame state of a recycled image. */
+    void Reset(void) {
+        ResetRef();
+        timeStamp = 0;
+        streamType = 0;
+        options = OPTION_ANY;
+        depthUnit = 1000;
+        metadata.clear();
+        FreeConversions();
+        cacheHits = 0;
+        cacheMisses = 0;
+    }
+
+    /* Free the converted planes; an idle pooled image holds only its native planes. */
+    void FreeConversions(void) {
+        for (size_t i = 0; i < conversions.size(); i++) PXCImageStorage::FreeBuffer(conversions[i].buffer);
+        conversions.clear();
+        readers = 0;
+        writers = 0;
+    }
+
+    ImageInfo           info;
+    ImageData           data;
+    PXCImageStorage     *storage;
+    size_t              bufferSize;         /* the bytes allocated at creation, as accounted by the pool */
+    PXCImagePool        *pool;
+    pxcI32              node;               /* the NUMA node of the planes, or -1 */
+    PXCImageImpl        *parent;            /* the image a view was created from */
+    pxcUID              uid;
+    pxcI64              timeStamp;
+    pxcEnum             streamType;
+    Option              options;
+    pxcF32              depthUnit;
+    std::mutex          mutex;
+    Metadata            metadata;
+    std::mutex          accessMutex;
+    std::vector<Conversion> conversions;
+    pxcI32              readers;            /* outstanding native read accesses */
+    pxcI32              writers;            /* outstanding native write accesses */
+    pxcI64              cacheHits;
+    pxcI64              cacheMisses;
+    std::list<PXCImageImpl*>::iterator lru;
+};
+
+/**
+    This class pools PXCImageImpl instances by ImageInfo. An image created from
+    the pool returns to the pool when its reference count drops to zero, and the
+    next CreateImage call with the same width, height and pixel format reuses it.
+
+    The pool keeps at most the high watermark of idle image bytes. When an image
+    returns above the high watermark, the least recently returned images are freed
+    until the idle bytes drop to the low watermark.
+
+    The pool itself is reference counted. Every outstanding image holds a reference,
+    so the pool outlives the images it created.
+*/
+class PXCImagePool {
+public:
+
+    /**
+        @structure Statistics
+        Describes the pool usage counters.
+    */
+    struct Statistics {
+        pxcI64  hits;               /* CreateImage calls served from the pool */
+        pxcI64  misses;             /* CreateImage calls that allocated a new image */
+        pxcI64  recycled;           /* images returned to the pool */
+        pxcI64  trimmed;            /* idle images freed by the watermarks or Trim */
+        pxcI64  idleImages;         /* images currently idle in the pool */
+        pxcI64  idleBytes;          /* bytes currently idle in the pool */
+        pxcI64  outstanding;        /* pooled images currently in use */
+        pxcI64  peakBytes;          /* the highest bytes in use or idle */
+        pxcI64  conversionHits;     /* format conversions served from the image caches, counted when images return */
+        pxcI64  conversionMisses;   /* format conversions performed, counted when images return */
+        pxcI64  reserved[6];
+    };
+
+    PXC_DEFINE_CONST(DEFAULT_HIGH_WATERMARK, 256<<20);
+    PXC_DEFINE_CONST(DEFAULT_LOW_WATERMARK, 128<<20);
+
+    PXCImagePool(void):refCount(1),highWatermark(DEFAULT_HIGH_WATERMARK),lowWatermark(DEFAULT_LOW_WATERMARK),usedBytes(0),numaNode(-1) {
+        memset(&stats, 0, sizeof(stats));
+        PXCImageConversion::InitToneMapping(&toneMapping);
+    }
+
+    pxcI32 AddRef(void) { return ++refCount; }
+
+    void Release(void) {
+        if (!--refCount) delete this;
+    }
+
+    /**
+        @brief Create an instance of the PXCImage interface. See PXCSession::CreateImage.
+        Images without application data are served from the pool.
+        @param[in]  info            The format and resolution of the image.
+        @param[in]  data            Optional image data, maintained by the application.
+        @return The PXCImage instance, or NULL if the allocation failed.
+    */
+    PXCImage* CreateImage(PXCImage::ImageInfo *info, PXCImage::ImageData *data=0) {
+        if (!info || info->width <= 0 || info->height <= 0) return 0;
+        if (data) return new PXCImageImpl(*info, *data);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Idle::iterator it = idle.find(Key(*info));
+            if (it != idle.end() && !it->second.empty()) {
+                PXCImageImpl *image = it->second.back();
+                it->second.pop_back();
+                lru.erase(image->lru);
+                stats.hits++;
+                stats.idleImages--;
+                stats.idleBytes -= image->bufferSize;
+                stats.outstanding++;
+                usedBytes += image->bufferSize;
+                image->Reset();
+                AddRef();
+                return image;
+            }
+        }
+
+        PXCImageImpl *image = new PXCImageImpl(*info, this, numaNode.load());
+        if (!image->storage) {
+            delete image;
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.misses++;
+        stats.outstanding++;
+        usedBytes += image->bufferSize;
+        if (usedBytes + stats.idleBytes > stats.peakBytes) stats.peakBytes = usedBytes + stats.idleBytes;
+        AddRef();
+        return image;
+    }
+
+    /**
+        @brief Create an instance of the PXCImage interface that references application image
+        data without copying it. The image is not pooled.
+        @param[in]  info            The format and resolution of the image.
+        @param[in]  data            The image data.
+        @param[in]  release         The callback invoked when the image no longer references the data.
+        @param[in]  context         The callback context.
+        @return The PXCImage instance, or NULL if the parameters are invalid.
+    */
+    PXCImage* CreateImage(PXCImage::ImageInfo *info, PXCImage::ImageData *data, PXCImageStorage::ReleaseCallback release, void *context) {
+        if (!info || !data || info->width <= 0 || info->height <= 0) return 0;
+        return new PXCImageImpl(*info, *data, release, context);
+    }
+
+    /**
+        @brief Set the idle byte watermarks. Returned images above the high watermark
+        trim the pool down to the low watermark.
+        @param[in]  low             The low watermark in bytes.
+        @param[in]  high            The high watermark in bytes.
+        @return PXC_STATUS_NO_ERROR         Successful execution.
+    */
+    pxcStatus SetWatermarks(pxcI64 low, pxcI64 high) {
+        if (low < 0 || high < low) return PXC_STATUS_PARAM_UNSUPPORTED;
+        std::vector<PXCImageImpl*> freed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            lowWatermark = low;
+            highWatermark = high;
+            if (stats.idleBytes > highWatermark) TrimLocked(lowWatermark, freed);
+        }
+        Free(freed);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /**
+        @brief Bind the planes of the images the pool allocates to a NUMA node, typically the
+        node of the workers that process them. Idle images are freed so that new images are
+        allocated on the node; images in use keep their planes. NUMA binding is supported on
+        Linux only.
+        @param[in]  node            The NUMA node, or -1 for any node.
+        @return PXC_STATUS_NO_ERROR         Successful execution.
+        @return PXC_STATUS_PARAM_UNSUPPORTED Invalid node.
+        @return PXC_STATUS_FEATURE_UNSUPPORTED NUMA binding is not supported on the platform.
+    */
+    pxcStatus SetNumaNode(pxcI32 node) {
+        if (node < -1 || node >= PXCImageStorage::MAX_NUMA_NODES) return PXC_STATUS_PARAM_UNSUPPORTED;
+#if !defined(__linux__)
+        if (node >= 0) return PXC_STATUS_FEATURE_UNSUPPORTED;
+#endif
+        if (numaNode.exchange(node) != node) Trim(0);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /**
+        @brief Return the NUMA node of the pool, or -1 for any node.
+    */
+    pxcI32 QueryNumaNode(void) { return numaNode.load(); }
+
+    /**
+        @brief Free idle images until the idle bytes drop to the specified value.
+        @param[in]  bytes           The remaining idle bytes. Zero frees all idle images.
+    */
+    void Trim(pxcI64 bytes) {
+        std::vector<PXCImageImpl*> freed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            TrimLocked(bytes, freed);
+        }
+        Free(freed);
+    }
+
+    /**
+        @brief Set the contrast stretch of Y16 and Y8_IR_RELATIVE images accessed as Y8.
+        The limits are smoothed over the images of each stream type; images without a
+        stream type are stretched independently.
+        @param[in]  toneMapping     The percentiles and the smoothing; the limits are ignored.
+        @return PXC_STATUS_NO_ERROR         Successful execution.
+        @return PXC_STATUS_PARAM_UNSUPPORTED Invalid percentiles or smoothing.
+    */
+    pxcStatus SetToneMapping(const PXCImageConversion::ToneMapping &toneMapping) {
+        if (!(toneMapping.lowPercentile >= 0 && toneMapping.lowPercentile < toneMapping.highPercentile && toneMapping.highPercentile <= 100)
+            || !(toneMapping.smoothing >= 0 && toneMapping.smoothing < 1)) return PXC_STATUS_PARAM_UNSUPPORTED;
+        std::lock_guard<std::mutex> lock(mutex);
+        this->toneMapping = toneMapping;
+        this->toneMapping.low = this->toneMapping.high = -1;
+        toneLimits.clear();
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /**
+        @brief Return the tone mapping parameters.
+        @param[out] toneMapping     The tone mapping parameters, to be returned.
+    */
+    void QueryToneMapping(PXCImageConversion::ToneMapping *toneMapping) {
+        std::lock_guard<std::mutex> lock(mutex);
+        *toneMapping = this->toneMapping;
+    }
+
+    /**
+        @brief Return the pool usage counters.
+        @param[out] stats           The statistics, to be returned.
+    */
+    void QueryStatistics(Statistics *stats) {
+        std::lock_guard<std::mutex> lock(mutex);
+        *stats = this->stats;
+    }
+
+protected:
+    friend class PXCImageImpl;
+
+    struct Key {
+        pxcI32 width, height, format;
+        Key(const PXCImage::ImageInfo &info):width(info.width),height(info.height),format(info.format) {}
+        bool operator<(const Key &k) const {
+            if (format != k.format) return format < k.format;
+            if (width != k.width) return width < k.width;
+            return height < k.height;
+        }
+    };
+
+    typedef std::map<Key, std::vector<PXCImageImpl*> > Idle;
+
+    virtual ~PXCImagePool(void) {
+        Trim(0);
+    }
+
+    typedef std::map<pxcEnum, std::pair<pxcF32, pxcF32> > ToneLimits;
+
+    /* Tone map an IR image to Y8 with the limits of the previous image of its stream.
+       Images of one stream converted concurrently blend with the same previous limits. */
+    pxcStatus ToneMap(const PXCImage::ImageData *src, PXCImage::ImageData *dst, const PXCImage::ImageInfo &info, pxcEnum streamType) {
+        PXCImageConversion::ToneMapping state;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            state = toneMapping;
+            ToneLimits::iterator it = streamType ? toneLimits.find(streamType) : toneLimits.end();
+            if (it != toneLimits.end()) {
+                state.low = it->second.first;
+                state.high = it->second.second;
+            }
+        }
+        pxcStatus sts = PXCImageConversion::ToneMap(src, dst, info.width, info.height, &state);
+        if (sts >= PXC_STATUS_NO_ERROR && streamType) {
+            std::lock_guard<std::mutex> lock(mutex);
+            toneLimits[streamType] = std::make_pair(state.low, state.high);
+        }
+        return sts;
+    }
+
+    /* Called by PXCImageImpl::Release when the last reference is gone. */
+    void Recycle(PXCImageImpl *image) {
+        std::vector<PXCImageImpl*> freed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.recycled++;
+            stats.outstanding--;
+            stats.conversionHits += image->cacheHits;
+            stats.conversionMisses += image->cacheMisses;
+            image->cacheHits = image->cacheMisses = 0;
+            image->FreeConversions();
+            usedBytes -= image->bufferSize;
+            /* images that adopted application planes cannot be reused */
+            if ((pxcI64)image->bufferSize > highWatermark || image->storage->QuerySize() != image->bufferSize) {
+                freed.push_back(image);
+            } else {
+                idle[Key(image->info)].push_back(image);
+                image->lru = lru.insert(lru.end(), image);
+                stats.idleImages++;
+                stats.idleBytes += image->bufferSize;
+                if (stats.idleBytes > highWatermark) TrimLocked(lowWatermark, freed);
+            }
+        }
+        Free(freed);
+        Release();
+    }
+
+    /* Unlink the least recently returned images; called with the mutex held. */
+    void TrimLocked(pxcI64 bytes, std::vector<PXCImageImpl*> &freed) {
+        while (stats.idleBytes > bytes && !lru.empty()) {
+            PXCImageImpl *image = lru.front();
+            lru.pop_front();
+            std::vector<PXCImageImpl*> &images = idle[Key(image->info)];
+            images.erase(std::find(images.begin(), images.end(), image));
+            stats.trimmed++;
+            stats.idleImages--;
+            stats.idleBytes -= image->bufferSize;
+            freed.push_back(image);
+        }
+    }
+
+    static void Free(std::vector<PXCImageImpl*> &images) {
+        for (size_t i = 0; i < images.size(); i++) {
+            images[i]->pool = 0;
+            delete images[i];
+        }
+    }
+
+    std::atomic<int>            refCount;
+    std::mutex                  mutex;
+    Idle                        idle;
+    std::list<PXCImageImpl*>    lru;
+    Statistics                  stats;
+    pxcI64                      highWatermark;
+    pxcI64                      lowWatermark;
+    pxcI64                      usedBytes;
+    std::atomic<pxcI32>         numaNode;       /* the node of newly allocated planes, or -1 */
+    PXCImageConversion::ToneMapping toneMapping;
+    ToneLimits                  toneLimits;     /* the smoothed limits of each stream type */
+};
+
+__inline void PXCAPI PXCImageImpl::Release(void) {
+    if (ReleaseRef()) return;
+    if (pool) pool->Recycle(this); else delete this;
+}
+
+__inline pxcStatus PXCImageImpl::ConvertNative(ImageData *dst) {
+    if (pool && dst->format == PIXEL_FORMAT_Y8 && (info.format == PIXEL_FORMAT_Y16 || info.format == PIXEL_FORMAT_Y8_IR_RELATIVE))
+        return pool->ToneMap(&data, dst, info, streamType);
+    return PXCImageConversion::Convert(&data, dst, info.width, info.height, depthUnit);
+}
@@ -0,0 +1,71 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcimagerotation.h
+    Defines PXCImageRotation, the kernels behind the PXCImage::Rotation
+    options of PXCImage::AcquireAccess.
+ */
+#pragma once
+#include "pxcimage.h"
+
+class PXCImageRotation {
+public:
+
+    /**
+        @brief Check if images of a pixel format can be rotated.
+        @param[in] format       The pixel format.
+        @return true if the pixel format is supported.
+    */
+    static bool IsSupported(PXCImage::PixelFormat format);
+
+    /**
+        @brief Return the image size after rotation.
+        @param[in] width        The image width in pixels.
+        @param[in] height       The image height in pixels.
+        @param[in] rotation     The clockwise rotation.
+        @param[out] rotatedWidth    The rotated image width, to be returned.
+        @param[out] rotatedHeight   The rotated image height, to be returned.
+    */
+    static void QueryRotatedSize(pxcI32 width, pxcI32 height, PXCImage::Rotation rotation, pxcI32 *rotatedWidth, pxcI32 *rotatedHeight) {
+        bool swap = (rotation == PXCImage::ROTATION_90_DEGREE || rotation == PXCImage::ROTATION_270_DEGREE);
+        *rotatedWidth = swap ? height : width;
+        *rotatedHeight = swap ? width : height;
+    }
+
+    /**
+        @brief Rotate image data clockwise. The 90 and 270 degree rotations transpose the
+        image in cache sized tiles with SIMD block transposes; the kernels follow the
+        instruction sets selected by PXCImageConversion::SetCpuFeatures.
+        @param[in] src          The source image data.
+        @param[out] dst         The destination image data of the same pixel format and the rotated size.
+        @param[in] width        The source image width in pixels.
+        @param[in] height       The source image height in pixels.
+        @param[in] rotation     The clockwise rotation.
+        @return PXC_STATUS_NO_ERROR             Successful execution.
+        @return PXC_STATUS_PARAM_UNSUPPORTED    Unsupported pixel format or rotation.
+    */
+    static pxcStatus Rotate(const PXCImage::ImageData *src, PXCImage::ImageData *dst, pxcI32 width, pxcI32 height, PXCImage::Rotation rotation);
+};
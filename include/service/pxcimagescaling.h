@@ -0,0 +1,81 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcimagescaling.h
+    Defines PXCImageScaling, the downscaling kernels behind PXCImagePyramid.
+ */
+#pragma once
+#include "pxcimagepyramid.h"
+
+class PXCImageScaling {
+public:
+
+    /**
+        @brief Check if images of a pixel format can be downscaled with a filter.
+        @param[in] format       The pixel format.
+        @param[in] filter       The filter; FILTER_DEFAULT selects the filter of the pixel format.
+        @return true if the combination is supported.
+    */
+    static bool IsSupported(PXCImage::PixelFormat format, PXCImagePyramid::Filter filter);
+
+    /**
+        @brief Return the filter that FILTER_DEFAULT selects for a pixel format.
+        @param[in] format       The pixel format.
+        @return FILTER_MEDIAN_VALID for depth formats, FILTER_BOX otherwise.
+    */
+    static PXCImagePyramid::Filter QueryDefaultFilter(PXCImage::PixelFormat format) {
+        return (format & PXCImage::PIXEL_FORMAT_DEPTH) ? PXCImagePyramid::FILTER_MEDIAN_VALID : PXCImagePyramid::FILTER_BOX;
+    }
+
+    /**
+        @brief Return the image size after halving, rounding up.
+        @param[in] width        The image width in pixels.
+        @param[in] height       The image height in pixels.
+        @param[out] halfWidth   The downscaled image width, to be returned.
+        @param[out] halfHeight  The downscaled image height, to be returned.
+    */
+    static void QueryHalfSize(pxcI32 width, pxcI32 height, pxcI32 *halfWidth, pxcI32 *halfHeight) {
+        *halfWidth = (width + 1) / 2;
+        *halfHeight = (height + 1) / 2;
+    }
+
+    /**
+        @brief Halve the width and height of image data. Each destination pixel reduces a
+        2x2 source block; an odd last column or row is paired with itself. Color and IR
+        formats use FILTER_BOX, depth formats FILTER_MIN_VALID or FILTER_MEDIAN_VALID,
+        where zero (or NaN for DEPTH_F32) is invalid and a block without valid depth
+        yields zero. The kernels follow the instruction sets selected by
+        PXCImageConversion::SetCpuFeatures.
+        @param[in] src          The source image data.
+        @param[out] dst         The destination image data of the same pixel format and the halved size.
+        @param[in] width        The source image width in pixels.
+        @param[in] height       The source image height in pixels.
+        @param[in] filter       The filter.
+        @return PXC_STATUS_NO_ERROR             Successful execution.
+        @return PXC_STATUS_PARAM_UNSUPPORTED    Unsupported pixel format or filter.
+    */
+    static pxcStatus Downscale(const PXCImage::ImageData *src, PXCImage::ImageData *dst, pxcI32 width, pxcI32 height, PXCImagePyramid::Filter filter);
+};
@@ -0,0 +1,275 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcimplindex.h
+    Defines PXCImplIndex, a hash index over module descriptors that answers
+    PXCSession::QueryImpl style template queries in time proportional to the
+    number of candidates, with a cursor to iterate all matches in one pass.
+ */
+#pragma once
+#include "pxcsession.h"
+#include <algorithm>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+class PXCImplIndex {
+public:
+
+    /**
+        @structure Cursor
+        The iteration state of a template query. Initialize it with QueryFirst
+        and advance it with QueryNext. Any change to the index invalidates the cursor.
+    */
+    struct Cursor {
+        PXCSession::ImplDesc        templat;    /* the search template */
+        const std::vector<pxcI32>   *list;      /* the candidate list */
+        size_t                      pos;        /* the next candidate position */
+        uint32_t                    generation; /* the index generation the cursor was started on */
+    };
+
+    PXCImplIndex(void):generation(0) {}
+
+    /**
+        @brief Add a module descriptor to the index. Descriptors are returned
+        by the highest merit first, then in the order they were added.
+        @param[in] desc         The module descriptor.
+        @param[in] payload      Optional application data returned with the descriptor.
+    */
+    void Add(const PXCSession::ImplDesc &desc, void *payload=0) {
+        Item item = { desc, payload };
+        items.push_back(item);
+        Post((pxcI32)items.size() - 1, true);
+        generation++;
+    }
+
+    /**
+        @brief Replace the index content with a snapshot of all modules of a session.
+        @param[in] session      The session instance.
+        @return PXC_STATUS_NO_ERROR     Successful execution.
+    */
+    pxcStatus Build(PXCSession *session) {
+        if (!session) return PXC_STATUS_HANDLE_INVALID;
+        items.clear();
+        PXCSession::ImplDesc desc;
+        for (pxcI32 i = 0; session->QueryImpl(0, i, &desc) >= PXC_STATUS_NO_ERROR; i++) {
+            Item item = { desc, 0 };
+            items.push_back(item);
+        }
+        Rehash();
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /** 
+        @brief Remove all descriptors from the index.
+    */
+    void Clear(void) {
+        items.clear();
+        Rehash();
+    }
+
+    /**
+        @brief Return the number of descriptors in the index.
+    */
+    pxcI32 QueryCount(void) const { return (pxcI32)items.size(); }
+
+    /**
+        @brief Start a template query and return the first match.
+        @param[in]    templat           The template for the module search. Zero field values match any.
+        @param[out]   cursor            The iteration state, to be returned.
+        @param[out]   desc              The matched module descriptor, to be returned.
+        @param[out]   payload           Optional payload of the matched descriptor, to be returned.
+        @return PXC_STATUS_NO_ERROR            Successful execution.
+        @return PXC_STATUS_ITEM_UNAVAILABLE    No matched module implementation.
+    */
+    pxcStatus QueryFirst(const PXCSession::ImplDesc *templat, Cursor *cursor, PXCSession::ImplDesc *desc, void **payload=0) const {
+        if (!cursor) return PXC_STATUS_HANDLE_INVALID;
+        if (templat) cursor->templat = *templat; else memset(&cursor->templat, 0, sizeof(cursor->templat));
+        cursor->list = Candidates(cursor->templat);
+        cursor->pos = 0;
+        cursor->generation = generation;
+        return QueryNext(cursor, desc, payload);
+    }
+
+    /**
+        @brief Return the next match of a template query.
+        @param[in,out] cursor           The iteration state.
+        @param[out]   desc              The matched module descriptor, to be returned.
+        @param[out]   payload           Optional payload of the matched descriptor, to be returned.
+        @return PXC_STATUS_NO_ERROR            Successful execution.
+        @return PXC_STATUS_ITEM_UNAVAILABLE    No more matches.
+        @return PXC_STATUS_HANDLE_INVALID      The index changed since the cursor was started.
+    */
+    pxcStatus QueryNext(Cursor *cursor, PXCSession::ImplDesc *desc, void **payload=0) const {
+        if (!cursor || cursor->generation != generation) return PXC_STATUS_HANDLE_INVALID;
+        while (cursor->pos < cursor->list->size()) {
+            size_t i = (size_t)(*cursor->list)[cursor->pos];
+            cursor->pos++;
+            if (!Match(&cursor->templat, &items[i].desc)) continue;
+            if (desc) *desc = items[i].desc;
+            if (payload) *payload = items[i].payload;
+            return PXC_STATUS_NO_ERROR;
+        }
+        return PXC_STATUS_ITEM_UNAVAILABLE;
+    }
+
+    /**
+        @brief Index-based enumeration, compatible with PXCSession::QueryImpl.
+        Prefer QueryFirst/QueryNext to enumerate all matches.
+    */
+    pxcStatus QueryImpl(const PXCSession::ImplDesc *templat, pxcI32 idx, PXCSession::ImplDesc *desc, void **payload=0) const {
+        if (idx < 0) return PXC_STATUS_PARAM_UNSUPPORTED;
+        Cursor cursor;
+        pxcStatus sts = QueryFirst(templat, &cursor, desc, payload);
+        while (sts >= PXC_STATUS_NO_ERROR && idx-- > 0) sts = QueryNext(&cursor, desc, payload);
+        return sts;
+    }
+
+    /**
+        @brief Match a module descriptor against a search template. Zero template fields match any.
+        Group and subgroup are bit masks and match on any common bit; every non-zero
+        template cuid must be supported by the descriptor.
+        @param[in]    templat           The search template.
+        @param[in]    desc              The module descriptor.
+        @return true if the descriptor matches the template.
+    */
+    static bool Match(const PXCSession::ImplDesc *templat, const PXCSession::ImplDesc *desc) {
+        if (templat->group && !(templat->group & desc->group)) return false;
+        if (templat->subgroup && !(templat->subgroup & desc->subgroup)) return false;
+        if (templat->algorithm && templat->algorithm != desc->algorithm) return false;
+        if (templat->iuid && templat->iuid != desc->iuid) return false;
+        if (templat->vendor && templat->vendor != desc->vendor) return false;
+        if (templat->version.major && templat->version.major != desc->version.major) return false;
+        for (int i = 0; i < 4 && templat->cuids[i]; i++) {
+            bool found = false;
+            for (int j = 0; j < 4 && desc->cuids[j] && !found; j++)
+                found = (templat->cuids[i] == desc->cuids[j]);
+            if (!found) return false;
+        }
+        return true;
+    }
+
+protected:
+
+    struct Item {
+        PXCSession::ImplDesc    desc;
+        void                    *payload;
+    };
+
+    enum KeyType {
+        KEY_GROUP       = 1,    /* one group bit and one subgroup bit (or none) */
+        KEY_CUID        = 2,
+        KEY_IUID        = 3,
+        KEY_VENDOR      = 4,
+    };
+
+    struct Key {
+        KeyType     type;
+        uint32_t    hi;
+        uint32_t    lo;
+
+        Key(void):type(KEY_GROUP),hi(0),lo(0) {}
+        Key(KeyType type, uint32_t hi, uint32_t lo):type(type),hi(hi),lo(lo) {}
+        bool operator==(const Key &other) const { return type == other.type && hi == other.hi && lo == other.lo; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            uint64_t v = ((uint64_t)key.hi << 32 | key.lo) * 0x9E3779B97F4A7C15ull;
+            return (size_t)(v ^ (v >> 32) ^ (uint64_t)key.type);
+        }
+    };
+
+    typedef std::unordered_map<Key, std::vector<pxcI32>, KeyHash> Postings;
+
+    static bool SingleBit(uint32_t v) { return v && !(v & (v - 1)); }
+
+    /* Insert an item into a list kept in merit order; equal merits keep the order they were added. */
+    void Insert(std::vector<pxcI32> &list, pxcI32 i, bool sorted) {
+        if (!sorted) { list.push_back(i); return; }
+        std::vector<pxcI32>::iterator it = list.end();
+        while (it != list.begin() && items[*(it - 1)].desc.merit < items[i].desc.merit) --it;
+        list.insert(it, i);
+    }
+
+    /* Post one item under all its keys. */
+    void Post(pxcI32 i, bool sorted) {
+        const PXCSession::ImplDesc &desc = items[i].desc;
+        Insert(order, i, sorted);
+        /* post under every group bit, alone and combined with every subgroup bit */
+        for (uint32_t g = (uint32_t)desc.group; g; g &= g - 1) {
+            uint32_t gbit = g & (~g + 1);
+            Insert(postings[Key(KEY_GROUP, gbit, 0)], i, sorted);
+            for (uint32_t s = (uint32_t)desc.subgroup; s; s &= s - 1)
+                Insert(postings[Key(KEY_GROUP, gbit, s & (~s + 1))], i, sorted);
+        }
+        for (int j = 0; j < 4 && desc.cuids[j]; j++)
+            Insert(postings[Key(KEY_CUID, 0, (uint32_t)desc.cuids[j])], i, sorted);
+        Insert(postings[Key(KEY_IUID, 0, (uint32_t)desc.iuid)], i, sorted);
+        Insert(postings[Key(KEY_VENDOR, 0, (uint32_t)desc.vendor)], i, sorted);
+    }
+
+    void Rehash(void) {
+        std::vector<pxcI32> sorted(items.size());
+        for (size_t i = 0; i < items.size(); i++) sorted[i] = (pxcI32)i;
+        std::stable_sort(sorted.begin(), sorted.end(), MeritGreater(items));
+        order.clear();
+        postings.clear();
+        /* posting in merit order keeps every list sorted */
+        for (size_t i = 0; i < sorted.size(); i++) Post(sorted[i], false);
+        generation++;
+    }
+
+    struct MeritGreater {
+        const std::vector<Item> &items;
+        MeritGreater(const std::vector<Item> &items):items(items) {}
+        bool operator()(pxcI32 a, pxcI32 b) const { return items[a].desc.merit > items[b].desc.merit; }
+    };
+
+    /* Return the shortest candidate list among the indexed template fields. */
+    const std::vector<pxcI32> *Candidates(const PXCSession::ImplDesc &templat) const {
+        static const std::vector<pxcI32> none;
+        const std::vector<pxcI32> *best = &order;
+        Key keys[8];
+        int nkeys = 0;
+        if (templat.iuid) keys[nkeys++] = Key(KEY_IUID, 0, (uint32_t)templat.iuid);
+        for (int i = 0; i < 4 && templat.cuids[i]; i++) keys[nkeys++] = Key(KEY_CUID, 0, (uint32_t)templat.cuids[i]);
+        if (templat.vendor) keys[nkeys++] = Key(KEY_VENDOR, 0, (uint32_t)templat.vendor);
+        if (SingleBit((uint32_t)templat.group))
+            keys[nkeys++] = Key(KEY_GROUP, (uint32_t)templat.group, SingleBit((uint32_t)templat.subgroup) ? (uint32_t)templat.subgroup : 0);
+        for (int i = 0; i < nkeys; i++) {
+            Postings::const_iterator it = postings.find(keys[i]);
+            if (it == postings.end()) return &none;
+            if (it->second.size() < best->size()) best = &it->second;
+        }
+        return best;
+    }
+
+    std::vector<Item>   items;      /* the descriptors in the order they were added */
+    std::vector<pxcI32> order;      /* all items in merit order */
+    Postings            postings;   /* the items of every key in merit order */
+    uint32_t            generation; /* bumped on every change to invalidate cursors */
+};
@@ -0,0 +1,209 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcimplregistry.h
+    Defines PXCImplRegistry, a link-time registry of module export tables.
+    Modules linked into the application register their DLLExportTable with
+    PXC_REGISTER_STATIC_IMPL, and the registry answers QueryImpl and CreateImpl
+    from a PXCImplIndex in memory, without loading or scanning module files.
+ */
+#pragma once
+#include "service/pxcsessionservice.h"
+#include "service/pxcimplindex.h"
+#include <algorithm>
+#include <mutex>
+#include <string.h>
+#include <vector>
+
+class PXCImplRegistry {
+public:
+    typedef PXCSessionService::DLLExportTable DLLExportTable;
+
+    /**
+        @brief Register a module export table and the tables chained through its next field.
+        The tables must remain valid for the lifetime of the process.
+        @param[in] table        The export table.
+    */
+    static void Register(DLLExportTable *table) {
+        State &state = Instance();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (; table; table = table->next) {
+            if (std::find(state.tables.begin(), state.tables.end(), table) != state.tables.end()) continue;
+            state.tables.push_back(table);
+        }
+    }
+
+    /**
+        @brief Search a statically registered module implementation.
+        @param[in]    templat           The template for the module search. Zero field values match any.
+        @param[in]    idx               The zero-based index to retrieve multiple matches.
+        @param[out]   table             The matched export table, to be returned.
+        @return PXC_STATUS_NO_ERROR            Successful execution.
+        @return PXC_STATUS_ITEM_UNAVAILABLE    No matched module implementation.
+    */
+    static pxcStatus QueryImplEx(PXCSession::ImplDesc *templat, pxcI32 idx, DLLExportTable **table) {
+        if (!table || idx < 0) return PXC_STATUS_HANDLE_INVALID;
+        State &state = Instance();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.Index();
+        return state.index.QueryImpl(templat, idx, 0, (void**)table);
+    }
+
+    /**
+        @brief Enumerate all statically registered implementations matching a template in one pass.
+        @param[in]    templat           The template for the module search. Zero field values match any.
+        @param[out]   cursor            The iteration state, to be returned.
+        @param[out]   table             The matched export table, to be returned.
+        @return PXC_STATUS_NO_ERROR            Successful execution.
+        @return PXC_STATUS_ITEM_UNAVAILABLE    No matched module implementation.
+    */
+    static pxcStatus QueryFirst(PXCSession::ImplDesc *templat, PXCImplIndex::Cursor *cursor, DLLExportTable **table) {
+        State &state = Instance();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.Index();
+        return state.index.QueryFirst(templat, cursor, 0, (void**)table);
+    }
+
+    /**
+        @brief Return the next match of a QueryFirst enumeration. Registering new tables
+        during an enumeration invalidates the cursor.
+    */
+    static pxcStatus QueryNext(PXCImplIndex::Cursor *cursor, DLLExportTable **table) {
+        State &state = Instance();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.index.QueryNext(cursor, 0, (void**)table);
+    }
+
+    /**
+        @brief Search a statically registered module implementation. See PXCSession::QueryImpl.
+    */
+    static pxcStatus QueryImpl(PXCSession::ImplDesc *templat, pxcI32 idx, PXCSession::ImplDesc *desc) {
+        if (!desc) return PXC_STATUS_HANDLE_INVALID;
+        DLLExportTable *table = 0;
+        pxcStatus sts = QueryImplEx(templat, idx, &table);
+        if (sts >= PXC_STATUS_NO_ERROR) *desc = table->desc;
+        return sts;
+    }
+
+    /**
+        @brief Create an instance of a statically registered module. See PXCSession::CreateImpl.
+        @param[in]    session           The session that owns the instance.
+        @param[in]    scheduler         The scheduler service passed to the module.
+        @param[in]    accel             Optional accelerator passed to the module.
+        @param[in]    desc              Optional module descriptor.
+        @param[in]    iuid              Optional module implementation identifier.
+        @param[in]    cuid              Optional interface identifier.
+        @param[out]   instance          The created instance, to be returned.
+        @return PXC_STATUS_NO_ERROR            Successful execution.
+        @return PXC_STATUS_ITEM_UNAVAILABLE    No matched module implementation.
+    */
+    static pxcStatus CreateImpl(PXCSession *session, PXCSchedulerService *scheduler, PXCAccelerator *accel, PXCSession::ImplDesc *desc, pxcUID iuid, pxcUID cuid, void **instance) {
+        if (!instance) return PXC_STATUS_HANDLE_INVALID;
+        PXCSession::ImplDesc templat;
+        if (desc) templat = *desc; else memset(&templat, 0, sizeof(templat));
+        if (iuid) templat.iuid = iuid;
+        if (cuid && !templat.cuids[0]) templat.cuids[0] = cuid;
+
+        DLLExportTable *table = 0;
+        pxcStatus sts = QueryImplEx(&templat, 0, &table);
+        if (sts < PXC_STATUS_NO_ERROR) return sts;
+        return table->createInstance(session, scheduler, accel, table, cuid ? cuid : table->desc.cuids[0], (PXCBase**)instance);
+    }
+
+    /**
+        @brief Hand all statically registered tables to a session, so that the session
+        serves them through its regular QueryImpl and CreateImpl functions.
+        @param[in]    service           The session service.
+        @return PXC_STATUS_NO_ERROR     Successful execution.
+    */
+    static pxcStatus LoadImpl(PXCSessionService *service) {
+        if (!service) return PXC_STATUS_HANDLE_INVALID;
+        std::vector<DLLExportTable*> tables;
+        {
+            State &state = Instance();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            tables = state.tables;
+        }
+        for (size_t i = 0; i < tables.size(); i++) {
+            pxcStatus sts = service->LoadImpl(tables[i]);
+            if (sts < PXC_STATUS_NO_ERROR) return sts;
+        }
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /**
+        @brief Match a module descriptor against a search template. Zero template fields match any.
+        @param[in]    templat           The search template.
+        @param[in]    desc              The module descriptor.
+        @return true if the descriptor matches the template.
+    */
+    static bool Match(const PXCSession::ImplDesc *templat, const PXCSession::ImplDesc *desc) {
+        return PXCImplIndex::Match(templat, desc);
+    }
+
+    /**
+        A helper class to register an export table during static initialization.
+        Use the PXC_REGISTER_STATIC_IMPL macro instead of instantiating it directly.
+    */
+    class Registrar {
+    public:
+        Registrar(DLLExportTable *table) { Register(table); }
+    };
+
+protected:
+
+    struct State {
+        std::mutex                      mutex;
+        std::vector<DLLExportTable*>    tables;
+        PXCImplIndex                    index;
+        size_t                          indexed;
+
+        State(void):indexed(0) {}
+
+        /* post the tables registered since the last query; called with the mutex held */
+        void Index(void) {
+            for (; indexed < tables.size(); indexed++)
+                index.Add(tables[indexed]->desc, tables[indexed]);
+        }
+    };
+
+    static State &Instance(void) {
+        static State state;
+        return state;
+    }
+};
+
+#define PXC_REGISTRY_CONCAT2(X,Y) X##Y
+#define PXC_REGISTRY_CONCAT(X,Y) PXC_REGISTRY_CONCAT2(X,Y)
+
+/**
+    Register a module export table at static-initialization time, for example
+    PXC_REGISTER_STATIC_IMPL(g_faceModuleExportTable) in the module source file.
+    When the module is linked from a static library, link it as a whole archive
+    so that the linker keeps the registration object.
+*/
+#define PXC_REGISTER_STATIC_IMPL(TABLE) \
+    static PXCImplRegistry::Registrar PXC_REGISTRY_CONCAT(g_pxcStaticImpl, __LINE__)(&(TABLE))
@@ -0,0 +1,1054 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcschedulerimpl.h
+    Defines PXCSchedulerImpl, a work-stealing thread pool implementation of
+    PXCSchedulerService, and PXCSyncPointImpl and PXCTimelineSyncPointImpl, the
+    sync points it creates.
+ */
+#pragma once
+#include "pxcaddref.h"
+#include "service/pxcschedulerservice.h"
+#include "service/pxcsyncpointservice.h"
+#include "service/pxcslaballocator.h"
+#include "service/pxcwaitword.h"
+#include "service/pxcworkstealingdeque.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+    This class implements the PXCSyncPoint, PXCSyncPointService,
+    PXCSyncPointNotifyService and PXCAddRef interfaces. The sync point is in
+    progress until SignalSyncPoint sets its status; Synchronize then returns that
+    status. The status is a PXCWaitWord, so a waiting thread sleeps on a futex on
+    Linux and wakes within a single system call of the signal.
+
+    SynchronizeEx waits for any of many sync points by subscribing one waiter to
+    each of them, so the cost of a wakeup does not grow with the number of points.
+    On Linux, the OS events of SynchronizeEx are file descriptors, such as eventfd
+    descriptors, and are signaled while readable; the wait then goes through epoll.
+    Other platforms do not support OS events.
+*/
+class PXCSyncPointImpl:public PXCAddRefImpl<PXCBaseImplN<PXCSyncPoint,PXCSyncPointService,PXCSyncPointNotifyService> > {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('S','Y','N','I'));
+    PXC_SLAB_ALLOCATED(PXCSyncPointImpl)
+
+    PXCSyncPointImpl(void):status(PXC_STATUS_EXEC_INPROGRESS) {}
+
+    virtual void* PXCAPI QueryInstance(pxcUID cuid) {
+        if (cuid == CUID) return this;
+        return PXCAddRefImpl<PXCBaseImplN<PXCSyncPoint,PXCSyncPointService,PXCSyncPointNotifyService> >::QueryInstance(cuid);
+    }
+
+    virtual pxcStatus PXCAPI SignalSyncPoint(pxcStatus sts) {
+        if (sts == PXC_STATUS_EXEC_INPROGRESS) return PXC_STATUS_PARAM_UNSUPPORTED;
+        std::vector<Handler*> notify;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            status.Store(sts);
+            notify.swap(handlers);
+        }
+        for (size_t i = 0; i < notify.size(); i++) notify[i]->OnSignal(sts);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    virtual pxcStatus PXCAPI SubscribeSignal(Handler *handler) {
+        if (!handler) return PXC_STATUS_HANDLE_INVALID;
+        std::lock_guard<std::mutex> lock(mutex);
+        pxcStatus sts = (pxcStatus)status.Load();
+        if (sts == PXC_STATUS_EXEC_INPROGRESS) handlers.push_back(handler);
+        return sts;
+    }
+
+    virtual pxcStatus PXCAPI UnsubscribeSignal(Handler *handler) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Handler*>::iterator it = std::find(handlers.begin(), handlers.end(), handler);
+        if (it == handlers.end()) return PXC_STATUS_ITEM_UNAVAILABLE;
+        handlers.erase(it);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /**
+        @brief Return the status of the sync point without waiting.
+        @return PXC_STATUS_EXEC_INPROGRESS until the sync point is signaled, then the signaled status.
+    */
+    pxcStatus QueryStatus(void) const { return (pxcStatus)status.Load(); }
+
+    virtual pxcStatus PXCAPI Synchronize(pxcI32 timeout) {
+        pxcStatus sts = QueryStatus();
+        if (sts != PXC_STATUS_EXEC_INPROGRESS) return sts;
+        if (!timeout) return PXC_STATUS_EXEC_TIMEOUT;
+        PXCWaitWord::Clock::time_point deadline = Deadline(timeout);
+        if (!status.Wait(PXC_STATUS_EXEC_INPROGRESS, timeout > 0 ? &deadline : 0)) return PXC_STATUS_EXEC_TIMEOUT;
+        return QueryStatus();
+    }
+
+protected:
+
+    /* Waits for any of several sync points; see SynchronizeExINT. */
+    class AnyWaiter:public Handler {
+    public:
+        AnyWaiter(void):signaled(0),pending(0) {}
+
+        /* The decrement is the last access: once pending drops to zero the waiter may be gone. */
+        virtual void PXCAPI OnSignal(pxcStatus) {
+            signaled.Store(1);
+#if defined(__linux__)
+            if (eventfd >= 0) { eventfd_t one = 1; ::write(eventfd, &one, sizeof(one)); }
+#endif
+            pending.fetch_sub(1);
+        }
+
+        PXCWaitWord         signaled;
+        std::atomic<int>    pending;        /* subscriptions that may still call OnSignal */
+#if defined(__linux__)
+        int                 eventfd;        /* also written on signal when waiting through epoll */
+#endif
+    };
+
+    static PXCWaitWord::Clock::time_point Deadline(pxcI32 timeout) {
+        return PXCWaitWord::Clock::now() + std::chrono::milliseconds(timeout > 0 ? timeout : 0);
+    }
+
+    static pxcI32 Remaining(pxcI32 timeout, const PXCWaitWord::Clock::time_point &deadline) {
+        if (timeout < 0) return timeout;
+        pxcI64 left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - PXCWaitWord::Clock::now()).count();
+        return (pxcI32)(left > 0 ? left : 0);
+    }
+
+    virtual pxcStatus PXCAPI SynchronizeExINT(pxcI32 n1, PXCSyncPoint **sps, pxcI32 n2, void **events, pxcI32 *idx, pxcI32 timeout) {
+        return SynchronizeMany(n1, sps, n2, events, idx, timeout);
+    }
+
+public:
+
+    /**
+        @brief Wait for all or any of several sync points and OS events, as SynchronizeEx does. The
+        sync points may be of any implementation that exposes PXCSyncPointNotifyService.
+    */
+    static pxcStatus SynchronizeMany(pxcI32 n1, PXCSyncPoint **sps, pxcI32 n2, void **events, pxcI32 *idx, pxcI32 timeout) {
+        pxcI32 nevents = 0;
+        for (pxcI32 j = 0; j < n2; j++)
+            if (events && events[j]) nevents++;
+#if !defined(__linux__)
+        if (nevents) return PXC_STATUS_FEATURE_UNSUPPORTED;
+#endif
+        PXCWaitWord::Clock::time_point deadline = Deadline(timeout);
+
+        if (!idx) {
+            /* wait for all: the first error wins */
+            pxcStatus result = PXC_STATUS_NO_ERROR;
+            for (pxcI32 i = 0; i < n1; i++) {
+                if (!sps[i]) continue;
+                pxcStatus sts = sps[i]->Synchronize(Remaining(timeout, deadline));
+                if (sts == PXC_STATUS_EXEC_TIMEOUT) return sts;
+                if (sts < PXC_STATUS_NO_ERROR && result >= PXC_STATUS_NO_ERROR) result = sts;
+            }
+#if defined(__linux__)
+            if (nevents) {
+                pxcStatus sts = WaitEvents(n2, events, -1, 0, timeout, deadline, true);
+                if (sts < PXC_STATUS_NO_ERROR) return sts;
+            }
+#endif
+            return result;
+        }
+
+        /* wait for any: subscribe one waiter to every sync point still in progress */
+        std::vector<PXCSyncPointNotifyService*> points(n1 > 0 ? n1 : 0, (PXCSyncPointNotifyService*)0);
+        bool valid = nevents > 0;
+        for (pxcI32 i = 0; i < n1; i++) {
+            if (!sps[i]) continue;
+            if (!(points[i] = sps[i]->QueryInstance<PXCSyncPointNotifyService>())) return PXC_STATUS_HANDLE_INVALID;
+            valid = true;
+        }
+        if (!valid) return PXC_STATUS_HANDLE_INVALID;
+
+        AnyWaiter waiter;
+#if defined(__linux__)
+        waiter.eventfd = nevents ? ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK) : -1;
+        if (nevents && waiter.eventfd < 0) return PXC_STATUS_ALLOC_FAILED;
+#endif
+        pxcI32 subscribed = 0;
+        pxcStatus result = PXC_STATUS_EXEC_TIMEOUT;
+        for (; subscribed < n1; subscribed++) {
+            if (!points[subscribed]) continue;
+            waiter.pending.fetch_add(1);
+            pxcStatus sts = points[subscribed]->SubscribeSignal(&waiter);
+            if (sts == PXC_STATUS_EXEC_INPROGRESS) continue;
+            waiter.pending.fetch_sub(1);
+            *idx = subscribed, result = sts;
+            break;
+        }
+
+        if (result == PXC_STATUS_EXEC_TIMEOUT) {
+#if defined(__linux__)
+            if (nevents) {
+                pxcI32 ready = -1;
+                pxcStatus sts = WaitEvents(n2, events, waiter.eventfd, &ready, timeout, deadline, false);
+                if (sts < PXC_STATUS_NO_ERROR && sts != PXC_STATUS_EXEC_TIMEOUT) result = sts;
+                else if (ready >= 0) *idx = n1 + ready, result = PXC_STATUS_NO_ERROR;
+            } else
+#endif
+            waiter.signaled.Wait(0, timeout >= 0 ? &deadline : 0);
+        }
+
+        /* withdraw the waiter, then let notifications already under way finish with it */
+        for (pxcI32 i = 0; i < subscribed; i++)
+            if (points[i] && points[i]->UnsubscribeSignal(&waiter) >= PXC_STATUS_NO_ERROR) waiter.pending.fetch_sub(1);
+        while (waiter.pending.load()) std::this_thread::yield();
+#if defined(__linux__)
+        if (waiter.eventfd >= 0) ::close(waiter.eventfd);
+#endif
+
+        if (result == PXC_STATUS_EXEC_TIMEOUT) {
+            for (pxcI32 i = 0; i < n1; i++) {
+                pxcStatus sts = points[i] ? sps[i]->Synchronize(0) : PXC_STATUS_EXEC_TIMEOUT;
+                if (sts != PXC_STATUS_EXEC_TIMEOUT) { *idx = i, result = sts; break; }
+            }
+        }
+        return result;
+    }
+
+protected:
+
+#if defined(__linux__)
+    /* Wait on the readable file descriptors in events through epoll. For all, wait until every
+       descriptor is readable; for any, return the index of the first readable descriptor, or
+       return when the wake descriptor is readable. */
+    static pxcStatus WaitEvents(pxcI32 n2, void **events, int wakefd, pxcI32 *ready, pxcI32 timeout, const PXCWaitWord::Clock::time_point &deadline, bool all) {
+        int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epfd < 0) return PXC_STATUS_ALLOC_FAILED;
+        pxcI32 remaining = 0;
+        pxcStatus result = PXC_STATUS_NO_ERROR;
+        for (pxcI32 j = 0; j < n2 && result == PXC_STATUS_NO_ERROR; j++) {
+            if (!events[j]) continue;
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.u64 = (uint64_t)j;
+            if (::epoll_ctl(epfd, EPOLL_CTL_ADD, (int)(intptr_t)events[j], &ev) < 0) result = PXC_STATUS_HANDLE_INVALID;
+            remaining++;
+        }
+        if (wakefd >= 0 && result == PXC_STATUS_NO_ERROR) {
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.u64 = ~(uint64_t)0;
+            if (::epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev) < 0) result = PXC_STATUS_HANDLE_INVALID;
+        }
+
+        struct epoll_event fired[64];
+        while (result == PXC_STATUS_NO_ERROR && remaining > 0) {
+            int n = ::epoll_wait(epfd, fired, 64, Remaining(timeout, deadline));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) { result = PXC_STATUS_HANDLE_INVALID; break; }
+            if (n == 0) { result = PXC_STATUS_EXEC_TIMEOUT; break; }
+            for (int k = 0; k < n; k++) {
+                if (fired[k].data.u64 == ~(uint64_t)0) { remaining = 0; break; }
+                pxcI32 j = (pxcI32)fired[k].data.u64;
+                if (!all) { *ready = j, remaining = 0; break; }
+                ::epoll_ctl(epfd, EPOLL_CTL_DEL, (int)(intptr_t)events[j], 0);
+                remaining--;
+            }
+        }
+        ::close(epfd);
+        return result;
+    }
+#endif
+
+    PXCWaitWord                 status;
+    std::mutex                  mutex;          /* guards the handlers */
+    std::vector<Handler*>       handlers;       /* notified once when signaled */
+};
+
+/**
+    This class implements the PXCTimelineSyncPoint and PXCAddRef interfaces. The
+    value is an atomic, so QueryValue and a WaitFor that is already satisfied take no
+    lock. Failing signals record the range of values they completed; only a value
+    within the first and last failed values looks the ranges up under the lock.
+    Waiters sleep on a generation counter that each signal advances, since a futex
+    word is 32 bits and the value is 64.
+
+    The sync points from CreateSyncPoint are small views onto the timeline; they
+    register their handlers with the timeline, so SynchronizeEx can wait on them
+    together with the sync points of PXCSyncPointImpl.
+*/
+class PXCTimelineSyncPointImpl:public PXCAddRefImpl<PXCBaseImpl<PXCTimelineSyncPoint> > {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('S','Y','T','I'));
+
+    explicit PXCTimelineSyncPointImpl(pxcI64 value = 0):value(value),firstError(INT64_MAX),lastError(INT64_MIN),generation(0) {}
+
+    virtual void* PXCAPI QueryInstance(pxcUID cuid) {
+        if (cuid == CUID) return this;
+        return PXCAddRefImpl<PXCBaseImpl<PXCTimelineSyncPoint> >::QueryInstance(cuid);
+    }
+
+    virtual pxcI64 PXCAPI QueryValue(void) { return value.load(); }
+
+    virtual pxcStatus PXCAPI SignalValue(pxcI64 newValue, pxcStatus sts) {
+        if (sts == PXC_STATUS_EXEC_INPROGRESS) return PXC_STATUS_PARAM_UNSUPPORTED;
+        std::vector<Subscription> notify;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pxcI64 current = value.load(std::memory_order_relaxed);
+            if (newValue <= current) return PXC_STATUS_PARAM_UNSUPPORTED;
+            if (sts < PXC_STATUS_NO_ERROR) AddError(current + 1, newValue, sts);
+            value.store(newValue);
+            size_t kept = 0;
+            for (size_t i = 0; i < subscriptions.size(); i++) {
+                if (subscriptions[i].value <= newValue) notify.push_back(subscriptions[i]);
+                else subscriptions[kept++] = subscriptions[i];
+            }
+            subscriptions.resize(kept);
+            generation.Store(generation.Load() + 1);
+        }
+        for (size_t i = 0; i < notify.size(); i++) notify[i].handler->OnSignal(StatusOf(notify[i].value));
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    virtual pxcStatus PXCAPI WaitFor(pxcI64 target, pxcI32 timeout) {
+        PXCWaitWord::Clock::time_point deadline = PXCWaitWord::Clock::now() + std::chrono::milliseconds(timeout > 0 ? timeout : 0);
+        for (;;) {
+            int observed = generation.Load();
+            if (value.load() >= target) return StatusOf(target);
+            if (!timeout) return PXC_STATUS_EXEC_TIMEOUT;
+            if (!generation.Wait(observed, timeout > 0 ? &deadline : 0))
+                return value.load() >= target ? StatusOf(target) : PXC_STATUS_EXEC_TIMEOUT;
+        }
+    }
+
+    virtual pxcStatus PXCAPI CreateSyncPoint(pxcI64 target, PXCSyncPoint **sp) {
+        if (!sp) return PXC_STATUS_HANDLE_INVALID;
+        *sp = new Point(this, target);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+protected:
+
+    typedef PXCSyncPointNotifyService::Handler Handler;
+
+    /* A handler waiting for the timeline to reach a value. */
+    struct Subscription {
+        pxcI64      value;
+        Handler     *handler;
+    };
+
+    /* The PXCSyncPoint view of one timeline value. */
+    class Point:public PXCAddRefImpl<PXCBaseImplN<PXCSyncPoint,PXCSyncPointNotifyService> > {
+    public:
+        PXC_SLAB_ALLOCATED(Point)
+
+        Point(PXCTimelineSyncPointImpl *timeline, pxcI64 value):timeline(timeline),value(value) { timeline->AddRef(); }
+        virtual ~Point(void) { timeline->Release(); }
+
+        virtual pxcStatus PXCAPI Synchronize(pxcI32 timeout) { return timeline->WaitFor(value, timeout); }
+        virtual pxcStatus PXCAPI SubscribeSignal(Handler *handler) { return timeline->Subscribe(value, handler); }
+        virtual pxcStatus PXCAPI UnsubscribeSignal(Handler *handler) { return timeline->Unsubscribe(value, handler); }
+
+    protected:
+
+        virtual pxcStatus PXCAPI SynchronizeExINT(pxcI32 n1, PXCSyncPoint **sps, pxcI32 n2, void **events, pxcI32 *idx, pxcI32 timeout) {
+            return PXCSyncPointImpl::SynchronizeMany(n1, sps, n2, events, idx, timeout);
+        }
+
+        PXCTimelineSyncPointImpl    *timeline;
+        pxcI64                      value;
+    };
+
+    /* The values from first to last completed by a failing signal. */
+    struct ErrorRange {
+        pxcI64      first;
+        pxcI64      last;
+        pxcStatus   status;
+    };
+
+    /* The failed ranges kept; beyond it the two oldest merge, so values between them
+       report an error rather than success. */
+    PXC_DEFINE_CONST(MAX_ERROR_RANGES, 64);
+
+    /* Record a failing signal; called with the mutex held. */
+    void AddError(pxcI64 first, pxcI64 last, pxcStatus sts) {
+        if (!errors.empty() && errors.back().last + 1 == first && errors.back().status == sts) {
+            errors.back().last = last;
+        } else {
+            if (errors.size() >= MAX_ERROR_RANGES) {
+                errors[1].first = errors[0].first;
+                errors.erase(errors.begin());
+            }
+            ErrorRange range = { first, last, sts };
+            errors.push_back(range);
+        }
+        firstError.store(errors.front().first);
+        lastError.store(last);
+    }
+
+    pxcStatus StatusOf(pxcI64 target) {
+        if (target < firstError.load() || target > lastError.load()) return PXC_STATUS_NO_ERROR;
+        std::lock_guard<std::mutex> lock(mutex);
+        return StatusOfLocked(target);
+    }
+
+    pxcStatus StatusOfLocked(pxcI64 target) {
+        size_t lo = 0, hi = errors.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (errors[mid].last < target) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < errors.size() && errors[lo].first <= target ? errors[lo].status : PXC_STATUS_NO_ERROR;
+    }
+
+    pxcStatus Subscribe(pxcI64 target, Handler *handler) {
+        if (!handler) return PXC_STATUS_HANDLE_INVALID;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (value.load(std::memory_order_relaxed) >= target) return StatusOfLocked(target);
+        Subscription subscription = { target, handler };
+        subscriptions.push_back(subscription);
+        return PXC_STATUS_EXEC_INPROGRESS;
+    }
+
+    pxcStatus Unsubscribe(pxcI64 target, Handler *handler) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < subscriptions.size(); i++) {
+            if (subscriptions[i].value != target || subscriptions[i].handler != handler) continue;
+            subscriptions.erase(subscriptions.begin() + i);
+            return PXC_STATUS_NO_ERROR;
+        }
+        return PXC_STATUS_ITEM_UNAVAILABLE;
+    }
+
+    std::atomic<pxcI64>         value;
+    std::atomic<pxcI64>         firstError;     /* the first value of the failed ranges, or INT64_MAX */
+    std::atomic<pxcI64>         lastError;      /* the last value of the failed ranges, or INT64_MIN */
+    PXCWaitWord                 generation;     /* advanced by every signal */
+    std::mutex                  mutex;          /* guards the subscriptions and serializes signals */
+    std::vector<Subscription>   subscriptions;
+    std::vector<ErrorRange>     errors;         /* the failed ranges in order of value */
+};
+
+/**
+    This class implements the PXCSchedulerService, PXCSchedulerBatchService,
+    PXCSchedulerTimelineService, PXCSchedulerDeadlineService and
+    PXCSchedulerPlacementService interfaces on groups of worker threads. Each worker
+    owns a work-stealing deque: callbacks made ready by a worker, typically when a
+    callback marks its outputs, are pushed to that worker's deque and run in LIFO
+    order while the data is still in cache; idle workers steal from the other deques
+    of their group in FIFO order. Callbacks made ready by application threads, or by
+    the workers of another group, go through an injection queue of the group.
+    Callbacks with deadlines go through a queue of the group ordered by deadline
+    instead, which its workers serve first; a callback taken from it after its
+    deadline runs with PXC_STATUS_EXEC_ABORTED.
+
+    The scheduler starts with the default group. Further groups pin their workers to
+    a core set and a NUMA node on Linux, and keep the callbacks submitted to them on
+    their workers; isolated groups also take their cores away from the default group.
+
+    The dependency table records the outputs marked PXC_STATUS_EXEC_INPROGRESS and
+    the callbacks waiting for them, and the outputs marked with an error status. It
+    is split into shards by pointer hash, each with its own lock, so unrelated inputs
+    do not contend. An input that is not in the table is ready; a callback runs with
+    the first error status its inputs were marked with, or PXC_STATUS_NO_ERROR.
+    Marking an output with a successful status removes it from the table; an error
+    status stays until the output is marked again. A sync point created with outputs
+    waits for them like a callback, and is signaled with the status they are marked
+    with.
+
+    Releasing the scheduler stops the workers and runs every callback still queued or
+    waiting with PXC_STATUS_EXEC_ABORTED. Do not release the scheduler from one of its
+    own callbacks.
+*/
+class PXCSchedulerImpl:public PXCBaseImplN<PXCSchedulerService,PXCSchedulerBatchService,PXCSchedulerTimelineService,PXCSchedulerDeadlineService,PXCSchedulerPlacementService> {
+public:
+
+    /**
+        @structure Statistics
+        Describes the scheduler counters, summed over the workers.
+    */
+    struct Statistics {
+        pxcI64  executed;           /* callbacks run by the workers */
+        pxcI64  stolen;             /* callbacks a worker took from another worker's deque */
+        pxcI64  injected;           /* callbacks made ready by threads outside the pool */
+        pxcI64  sleeps;             /* times a worker found no work and slept */
+        pxcI64  queued;             /* callbacks ready but not yet running */
+        pxcI64  expired;            /* callbacks aborted because their deadline passed */
+        pxcI64  reserved[2];
+    };
+
+    /* the number of worker groups, including the default group */
+    PXC_DEFINE_CONST(MAX_GROUPS, 16);
+
+    /**
+        @brief Start the workers of the default group.
+        @param[in] nworkers     The number of workers, or zero for one worker per hardware thread.
+    */
+    explicit PXCSchedulerImpl(pxcI32 nworkers = 0):stopping(false),groupCount(0),workerCount(0),injectedTotal(0),clock(0),expired(0) {
+        if (nworkers <= 0) nworkers = (pxcI32)std::thread::hardware_concurrency();
+        if (nworkers <= 0) nworkers = 1;
+#if defined(__linux__)
+        CPU_ZERO(&reservedCores);
+        if (sched_getaffinity(0, sizeof(processCores), &processCores)) CPU_ZERO(&processCores);
+#endif
+        WorkerGroupInfo info;
+        memset(&info, 0, sizeof(info));
+        info.nworkers = nworkers;
+        info.numaNode = -1;
+        std::lock_guard<std::mutex> lock(groupsMutex);
+        StartGroup(&info);
+    }
+
+    virtual ~PXCSchedulerImpl(void) {
+        pxcI32 ngroups = groupCount.load();
+        stopping.store(true);
+        for (pxcI32 g = 0; g < ngroups; g++) {
+            std::lock_guard<std::mutex> lock(groups[g]->idleMutex);
+            groups[g]->idleCondition.notify_all();
+        }
+        for (pxcI32 g = 0; g < ngroups; g++)
+            for (size_t i = 0; i < groups[g]->workers.size(); i++) groups[g]->workers[i]->thread.join();
+        AbortAll();
+        for (pxcI32 g = 0; g < ngroups; g++) {
+            for (size_t i = 0; i < groups[g]->workers.size(); i++) delete groups[g]->workers[i];
+            delete groups[g];
+        }
+    }
+
+    virtual pxcStatus PXCAPI RequestInputs(pxcI32 ninput, void** inputs, Callback *cb) {
+        return Request(ninput, inputs, cb, NO_DEADLINE, groups[DEFAULT_GROUP]);
+    }
+
+    virtual pxcStatus PXCAPI MarkOutputs(pxcI32 noutput, void** outputs, pxcStatus sts) {
+        if (noutput < 0 || (noutput > 0 && !outputs)) return PXC_STATUS_HANDLE_INVALID;
+        for (pxcI32 i = 0; i < noutput; i++) {
+            if (!outputs[i]) continue;
+            Shard &shard = ShardOf(outputs[i]);
+            Waiter *waiter = 0;
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                Entries::iterator it = shard.entries.find(outputs[i]);
+                if (sts == PXC_STATUS_EXEC_INPROGRESS || (sts < PXC_STATUS_NO_ERROR && it == shard.entries.end())) {
+                    shard.entries[outputs[i]].status = sts;
+                    continue;
+                }
+                if (it == shard.entries.end()) continue;
+                waiter = it->second.waiters;
+                if (sts < PXC_STATUS_NO_ERROR) {
+                    it->second.status = sts;
+                    it->second.waiters = 0;
+                } else {
+                    shard.entries.erase(it);
+                }
+            }
+            while (waiter) {
+                Waiter *next = waiter->next;
+                Task *task = waiter->task;
+                if (sts < PXC_STATUS_NO_ERROR) {
+                    int expected = PXC_STATUS_NO_ERROR;
+                    task->status.compare_exchange_strong(expected, sts, std::memory_order_relaxed);
+                }
+                if (task->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) Schedule(task);
+                waiter = next;
+            }
+        }
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    virtual pxcStatus PXCAPI SubmitCallback(pxcI32 ninput, void** inputs, pxcI32 noutput, void** outputs, Callback *cb) {
+        pxcStatus sts = PXCSchedulerImpl::MarkOutputs(noutput, outputs, PXC_STATUS_EXEC_INPROGRESS);
+        if (sts < PXC_STATUS_NO_ERROR) return sts;
+        return PXCSchedulerImpl::RequestInputs(ninput, inputs, cb);
+    }
+
+    virtual pxcStatus PXCAPI SubmitDeadline(pxcI32 ninput, void** inputs, pxcI32 noutput, void** outputs, Callback *cb, pxcI64 deadline) {
+        pxcStatus sts = PXCSchedulerImpl::MarkOutputs(noutput, outputs, PXC_STATUS_EXEC_INPROGRESS);
+        if (sts < PXC_STATUS_NO_ERROR) return sts;
+        return Request(ninput, inputs, cb, deadline, groups[DEFAULT_GROUP]);
+    }
+
+    virtual pxcStatus PXCAPI CreateWorkerGroup(const WorkerGroupInfo *info, pxcI32 *group) {
+        if (!info || !group || (info->ncores > 0 && !info->cores)) return PXC_STATUS_HANDLE_INVALID;
+        if (info->nworkers <= 0 || info->ncores < 0 || info->numaNode < -1) return PXC_STATUS_PARAM_UNSUPPORTED;
+#if defined(__linux__)
+        for (pxcI32 i = 0; i < info->ncores; i++)
+            if (info->cores[i] < 0 || info->cores[i] >= CPU_SETSIZE || !CPU_ISSET(info->cores[i], &processCores)) return PXC_STATUS_PARAM_UNSUPPORTED;
+        if (info->numaNode >= MAX_NUMA_NODES) return PXC_STATUS_PARAM_UNSUPPORTED;
+#else
+        if (info->ncores > 0 || info->numaNode >= 0) return PXC_STATUS_FEATURE_UNSUPPORTED;
+#endif
+        std::lock_guard<std::mutex> lock(groupsMutex);
+        if (groupCount.load() >= MAX_GROUPS) return PXC_STATUS_ITEM_UNAVAILABLE;
+        *group = StartGroup(info)->index;
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    virtual pxcStatus PXCAPI SubmitToGroup(pxcI32 ninput, void** inputs, pxcI32 noutput, void** outputs, Callback *cb, pxcI32 group, pxcI64 deadline) {
+        if (group < 0 || group >= groupCount.load()) return PXC_STATUS_ITEM_UNAVAILABLE;
+        pxcStatus sts = PXCSchedulerImpl::MarkOutputs(noutput, outputs, PXC_STATUS_EXEC_INPROGRESS);
+        if (sts < PXC_STATUS_NO_ERROR) return sts;
+        return Request(ninput, inputs, cb, deadline, groups[group]);
+    }
+
+    virtual void PXCAPI SetClock(Clock *clock) {
+        this->clock.store(clock);
+    }
+
+    virtual pxcI64 PXCAPI QueryTime(void) {
+        Clock *clock = this->clock.load();
+        if (clock) return clock->QueryTime();
+        typedef std::chrono::duration<pxcI64, std::ratio<1, 10000000> > Ticks;
+        return std::chrono::duration_cast<Ticks>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /* The sync point is signaled with the status of the outputs once the last of them is
+       marked; the outputs are marked PXC_STATUS_EXEC_INPROGRESS until then. Without outputs,
+       the sync point waits for SignalSyncPoint. */
+    virtual pxcStatus PXCAPI CreateSyncPoint(pxcI32 noutput, void** outputs, PXCSyncPoint **sp) {
+        if (!sp || noutput < 0 || (noutput > 0 && !outputs)) return PXC_STATUS_HANDLE_INVALID;
+        PXCSyncPointImpl *point = new PXCSyncPointImpl;
+        if (noutput > 0) {
+            PXCSchedulerImpl::MarkOutputs(noutput, outputs, PXC_STATUS_EXEC_INPROGRESS);
+            point->AddRef();
+            Request(noutput, outputs, new OutputsSignal(point), NO_DEADLINE, groups[DEFAULT_GROUP]);
+        }
+        *sp = point;
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    virtual pxcStatus PXCAPI CreateTimeline(pxcI64 value, PXCTimelineSyncPoint **timeline) {
+        if (!timeline) return PXC_STATUS_HANDLE_INVALID;
+        *timeline = new PXCTimelineSyncPointImpl(value);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    /**
+        @brief Return the number of worker threads, over all groups.
+    */
+    pxcI32 QueryWorkers(void) const { return workerCount.load(); }
+
+    /**
+        @brief Return the scheduler counters.
+        @param[out] stats       The counters, summed over the workers of all groups.
+    */
+    void QueryStatistics(Statistics *stats) {
+        memset(stats, 0, sizeof(*stats));
+        for (pxcI32 g = 0, ngroups = groupCount.load(); g < ngroups; g++) {
+            Group *group = groups[g];
+            for (size_t i = 0; i < group->workers.size(); i++) {
+                stats->executed += group->workers[i]->executed.load(std::memory_order_relaxed);
+                stats->stolen += group->workers[i]->stolen.load(std::memory_order_relaxed);
+                stats->sleeps += group->workers[i]->sleeps.load(std::memory_order_relaxed);
+                stats->queued += group->workers[i]->deque.QuerySize();
+            }
+            stats->queued += group->injectedCount.load(std::memory_order_relaxed) + group->deadlineCount.load(std::memory_order_relaxed);
+        }
+        stats->injected = injectedTotal.load(std::memory_order_relaxed);
+        stats->expired = expired.load(std::memory_order_relaxed);
+    }
+
+protected:
+
+    struct Task;
+    struct Group;
+
+    /* A link in the list of callbacks waiting for one output. */
+    struct Waiter {
+        Task    *task;
+        Waiter  *next;
+    };
+
+    /* A callback and the number of inputs it still waits for. */
+    struct Task {
+        PXC_SLAB_ALLOCATED(Task)
+        enum { INLINE_WAITERS = 4 };
+
+        Callback            *cb;
+        std::atomic<int>    pending;
+        std::atomic<int>    status;
+        pxcI64              deadline;
+        Group               *group;
+        Waiter              *waiters;
+        Waiter              inlineWaiters[INLINE_WAITERS];
+
+        Task(Callback *cb, pxcI32 ninput, pxcI64 deadline, Group *group):cb(cb),pending(ninput + 1),status(PXC_STATUS_NO_ERROR),deadline(deadline),group(group) {
+            waiters = ninput > INLINE_WAITERS ? new Waiter[ninput] : inlineWaiters;
+        }
+        ~Task(void) { if (waiters != inlineWaiters) delete[] waiters; }
+    };
+
+    /* Signals a sync point with the status of the outputs it was created with. */
+    class OutputsSignal:public PXCBaseImpl<Callback> {
+    public:
+        PXC_SLAB_ALLOCATED(OutputsSignal)
+
+        explicit OutputsSignal(PXCSyncPointImpl *sp):sp(sp) {}
+        virtual ~OutputsSignal(void) { sp->Release(); }
+
+        virtual void PXCAPI Run(pxcStatus sts) {
+            sp->SignalSyncPoint(sts);
+            Release();
+        }
+
+    protected:
+        PXCSyncPointImpl    *sp;
+    };
+
+    /* An output in progress and the callbacks waiting for it, or an output marked with an error. */
+    struct Entry {
+        pxcStatus   status;
+        Waiter      *waiters;
+        Entry(void):status(PXC_STATUS_EXEC_INPROGRESS),waiters(0) {}
+    };
+
+    typedef std::unordered_map<void*, Entry> Entries;
+
+    /* Orders the deadline queue, a heap, earliest deadline first. */
+    struct LaterDeadline {
+        bool operator()(const Task *a, const Task *b) const { return a->deadline > b->deadline; }
+    };
+
+    struct Shard {
+        std::mutex  mutex;
+        Entries     entries;
+    };
+
+    struct Worker {
+        PXCSchedulerImpl            *scheduler;
+        Group                       *group;
+        pxcI32                      index;
+        unsigned int                seed;
+        std::thread                 thread;
+        PXCWorkStealingDeque<Task>  deque;
+        std::atomic<pxcI64>         executed;
+        std::atomic<pxcI64>         stolen;
+        std::atomic<pxcI64>         sleeps;
+
+        Worker(PXCSchedulerImpl *scheduler, Group *group, pxcI32 index):scheduler(scheduler),group(group),index(index),seed(2463534242u + index * 7919u),executed(0),stolen(0),sleeps(0) {}
+    };
+
+    /* Workers that share their callbacks, with the queues and the idle state they share. */
+    struct Group {
+        pxcI32                      index;
+        bool                        isolated;
+        pxcI32                      numaNode;
+        std::vector<pxcI32>         cores;          /* empty when the workers run on any core */
+        std::vector<Worker*>        workers;
+
+        std::mutex                  idleMutex;
+        std::condition_variable     idleCondition;
+        std::atomic<pxcI64>         epoch;          /* advanced whenever work is made ready */
+        std::atomic<int>            sleepers;
+
+        std::mutex                  injectedMutex;
+        std::deque<Task*>           injected;       /* callbacks made ready outside the workers of the group */
+        std::atomic<pxcI64>         injectedCount;
+
+        std::mutex                  deadlineMutex;
+        std::vector<Task*>          deadlineQueue;  /* ready callbacks with deadlines, a heap */
+        std::atomic<pxcI64>         deadlineCount;
+
+        Group(pxcI32 index, const WorkerGroupInfo *info):index(index),isolated(info->isolated != 0),numaNode(info->numaNode),
+            cores(info->cores, info->cores + (info->ncores > 0 ? info->ncores : 0)),epoch(0),sleepers(0),injectedCount(0),deadlineCount(0) {}
+    };
+
+    enum { SHARDS = 64, MAX_NUMA_NODES = 1024 };
+
+    Shard &ShardOf(void *key) {
+        unsigned long long h = (unsigned long long)(size_t)key * 0x9E3779B97F4A7C15ull;
+        return shards[h >> 58];
+    }
+
+    /* The worker running on the calling thread, if any. */
+    static Worker *&Current(void) {
+        static thread_local Worker *worker = 0;
+        return worker;
+    }
+
+    /* Link the callback to the inputs in progress; it runs once the last of them is marked. */
+    pxcStatus Request(pxcI32 ninput, void** inputs, Callback *cb, pxcI64 deadline, Group *group) {
+        if (!cb || ninput < 0 || (ninput > 0 && !inputs)) return PXC_STATUS_HANDLE_INVALID;
+        Task *task = new Task(cb, ninput, deadline, group);
+
+        /* count the inputs that are ready, plus one that holds the task until all are linked */
+        int ready = 1;
+        for (pxcI32 i = 0; i < ninput; i++) {
+            if (!inputs[i]) { ready++; continue; }
+            Shard &shard = ShardOf(inputs[i]);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            Entries::iterator it = shard.entries.find(inputs[i]);
+            if (it == shard.entries.end()) { ready++; continue; }
+            if (it->second.status != PXC_STATUS_EXEC_INPROGRESS) {
+                int expected = PXC_STATUS_NO_ERROR;
+                task->status.compare_exchange_strong(expected, it->second.status, std::memory_order_relaxed);
+                ready++;
+                continue;
+            }
+            Waiter *waiter = &task->waiters[i];
+            waiter->task = task;
+            waiter->next = it->second.waiters;
+            it->second.waiters = waiter;
+        }
+        if (task->pending.fetch_sub(ready, std::memory_order_acq_rel) == ready) Schedule(task);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    void Schedule(Task *task) {
+        Group *group = task->group;
+        Worker *worker = Current();
+        if (task->deadline != NO_DEADLINE) {
+            std::lock_guard<std::mutex> lock(group->deadlineMutex);
+            group->deadlineQueue.push_back(task);
+            std::push_heap(group->deadlineQueue.begin(), group->deadlineQueue.end(), LaterDeadline());
+            group->deadlineCount.fetch_add(1, std::memory_order_relaxed);
+        } else if (worker && worker->scheduler == this && worker->group == group) {
+            worker->deque.Push(task);
+        } else {
+            std::lock_guard<std::mutex> lock(group->injectedMutex);
+            group->injected.push_back(task);
+            group->injectedCount.fetch_add(1, std::memory_order_relaxed);
+            injectedTotal.fetch_add(1, std::memory_order_relaxed);
+        }
+        Wake(group);
+    }
+
+    /* Wake a worker of the group; the workers of non-isolated groups also run the callbacks of
+       the default group, so one of them takes a default callback when its own workers are busy. */
+    void Wake(Group *group) {
+        if (WakeOne(group) || group->index != DEFAULT_GROUP) return;
+        for (pxcI32 g = 1, ngroups = groupCount.load(); g < ngroups; g++)
+            if (!groups[g]->isolated && WakeOne(groups[g])) return;
+    }
+
+    static bool WakeOne(Group *group) {
+        group->epoch.fetch_add(1);
+        if (!group->sleepers.load()) return false;
+        std::lock_guard<std::mutex> lock(group->idleMutex);
+        group->idleCondition.notify_one();
+        return true;
+    }
+
+    static Task *PopInjected(Group *group) {
+        if (!group->injectedCount.load(std::memory_order_relaxed)) return 0;
+        std::lock_guard<std::mutex> lock(group->injectedMutex);
+        if (group->injected.empty()) return 0;
+        Task *task = group->injected.front();
+        group->injected.pop_front();
+        group->injectedCount.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+    }
+
+    static Task *PopDeadline(Group *group) {
+        if (!group->deadlineCount.load(std::memory_order_relaxed)) return 0;
+        std::lock_guard<std::mutex> lock(group->deadlineMutex);
+        if (group->deadlineQueue.empty()) return 0;
+        std::pop_heap(group->deadlineQueue.begin(), group->deadlineQueue.end(), LaterDeadline());
+        Task *task = group->deadlineQueue.back();
+        group->deadlineQueue.pop_back();
+        group->deadlineCount.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+    }
+
+    /* Take a callback of a group: by deadline, from the own deque if the worker is in the group,
+       from the injection queue, or from the deque of another worker of the group. */
+    static Task *FindInGroup(Worker *worker, Group *group) {
+        Task *task = PopDeadline(group);
+        if (task) return task;
+        if (worker->group == group && (task = worker->deque.Take()) != 0) return task;
+        if ((task = PopInjected(group)) != 0) return task;
+
+        size_t n = group->workers.size();
+        worker->seed ^= worker->seed << 13, worker->seed ^= worker->seed >> 17, worker->seed ^= worker->seed << 5;
+        for (size_t k = 0, start = worker->seed % n; k < n; k++) {
+            Worker *victim = group->workers[(start + k) % n];
+            if (victim == worker) continue;
+            if ((task = victim->deque.Steal()) != 0) {
+                worker->stolen.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        return 0;
+    }
+
+    Task *FindTask(Worker *worker) {
+        Task *task = FindInGroup(worker, worker->group);
+        if (task || worker->group->index == DEFAULT_GROUP || worker->group->isolated) return task;
+        return FindInGroup(worker, groups[DEFAULT_GROUP]);
+    }
+
+    static void Execute(Task *task) {
+        Callback *cb = task->cb;
+        pxcStatus sts = (pxcStatus)task->status.load(std::memory_order_relaxed);
+        delete task;
+        cb->Run(sts);
+    }
+
+    /* Create a group and start its workers; called with groupsMutex held. */
+    Group *StartGroup(const WorkerGroupInfo *info) {
+        pxcI32 index = groupCount.load();
+        Group *group = new Group(index, info);
+        for (pxcI32 i = 0; i < info->nworkers; i++) group->workers.push_back(new Worker(this, group, workerCount++));
+        groups[index] = group;
+        groupCount.store(index + 1);
+#if defined(__linux__)
+        if (group->isolated && !group->cores.empty()) {
+            for (size_t i = 0; i < group->cores.size(); i++) CPU_SET(group->cores[i], &reservedCores);
+            for (pxcI32 g = 0; g < index; g++)
+                for (size_t i = 0; groups[g]->cores.empty() && i < groups[g]->workers.size(); i++) ApplyCores(groups[g]->workers[i]);
+        }
+#endif
+        for (size_t i = 0; i < group->workers.size(); i++) group->workers[i]->thread = std::thread(&PXCSchedulerImpl::WorkerLoop, this, group->workers[i]);
+        return group;
+    }
+
+#if defined(__linux__)
+    /* Pin a worker to the cores of its group, or keep it off the cores of isolated groups;
+       called with groupsMutex held. */
+    void ApplyCores(Worker *worker) {
+        cpu_set_t cores;
+        CPU_ZERO(&cores);
+        if (!worker->group->cores.empty()) {
+            for (size_t i = 0; i < worker->group->cores.size(); i++) CPU_SET(worker->group->cores[i], &cores);
+        } else {
+            if (!CPU_COUNT(&reservedCores)) return;
+            for (int c = 0; c < CPU_SETSIZE; c++)
+                if (CPU_ISSET(c, &processCores) && !CPU_ISSET(c, &reservedCores)) CPU_SET(c, &cores);
+            if (!CPU_COUNT(&cores)) return;
+        }
+        pthread_setaffinity_np(worker->thread.native_handle(), sizeof(cores), &cores);
+    }
+
+    /* Prefer the NUMA node of the group for the memory the calling worker allocates. */
+    static void ApplyNumaNode(Group *group) {
+        if (group->numaNode < 0) return;
+        unsigned long nodes[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = { 0 };
+        nodes[group->numaNode / (8 * sizeof(unsigned long))] |= 1ul << (group->numaNode % (8 * sizeof(unsigned long)));
+        syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodes, (unsigned long)MAX_NUMA_NODES + 1);
+    }
+#endif
+
+    void WorkerLoop(Worker *worker) {
+        Current() = worker;
+        Group *group = worker->group;
+#if defined(__linux__)
+        char name[16];
+        snprintf(name, sizeof(name), "pxc-worker-%d", worker->index);
+        pthread_setname_np(pthread_self(), name);
+        {
+            std::lock_guard<std::mutex> lock(groupsMutex);
+            ApplyCores(worker);
+        }
+        ApplyNumaNode(group);
+#endif
+        for (;;) {
+            Task *task = FindTask(worker);
+            if (!task) {
+                pxcI64 observed = group->epoch.load();
+                if ((task = FindTask(worker)) == 0) {
+                    std::unique_lock<std::mutex> lock(group->idleMutex);
+                    if (stopping.load()) break;
+                    group->sleepers.fetch_add(1);
+                    if (group->epoch.load() == observed) {
+                        worker->sleeps.fetch_add(1, std::memory_order_relaxed);
+                        group->idleCondition.wait(lock);
+                    }
+                    group->sleepers.fetch_sub(1);
+                    continue;
+                }
+            }
+            worker->executed.fetch_add(1, std::memory_order_relaxed);
+            if (task->deadline != NO_DEADLINE && task->deadline < QueryTime()) {
+                task->status.store(PXC_STATUS_EXEC_ABORTED, std::memory_order_relaxed);
+                expired.fetch_add(1, std::memory_order_relaxed);
+            }
+            Execute(task);
+        }
+        Current() = 0;
+    }
+
+    /* Run the remaining callbacks with PXC_STATUS_EXEC_ABORTED, after the workers stopped.
+       The aborted callbacks may submit or release more work, so repeat until none is left. */
+    void AbortAll(void) {
+        pxcI32 ngroups = groupCount.load();
+        for (;;) {
+            std::vector<Task*> tasks;
+            for (pxcI32 g = 0; g < ngroups; g++) {
+                Group *group = groups[g];
+                for (size_t i = 0; i < group->workers.size(); i++)
+                    for (Task *task; (task = group->workers[i]->deque.Take()) != 0;) tasks.push_back(task);
+                for (Task *task; (task = PopInjected(group)) != 0;) tasks.push_back(task);
+                for (Task *task; (task = PopDeadline(group)) != 0;) tasks.push_back(task);
+            }
+            for (int s = 0; s < SHARDS; s++) {
+                std::lock_guard<std::mutex> lock(shards[s].mutex);
+                for (Entries::iterator it = shards[s].entries.begin(); it != shards[s].entries.end(); ++it)
+                    for (Waiter *waiter = it->second.waiters, *next; waiter; waiter = next) {
+                        next = waiter->next;
+                        if (waiter->task->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) tasks.push_back(waiter->task);
+                    }
+                shards[s].entries.clear();
+            }
+            if (tasks.empty()) break;
+            for (size_t i = 0; i < tasks.size(); i++) {
+                tasks[i]->status.store(PXC_STATUS_EXEC_ABORTED, std::memory_order_relaxed);
+                Execute(tasks[i]);
+            }
+        }
+    }
+
+    Shard                       shards[SHARDS];
+    std::atomic<bool>           stopping;
+
+    std::mutex                  groupsMutex;    /* serializes group creation and affinity changes */
+    Group                       *groups[MAX_GROUPS];
+    std::atomic<pxcI32>         groupCount;
+    std::atomic<pxcI32>         workerCount;
+#if defined(__linux__)
+    cpu_set_t                   processCores;   /* the cores the process may run on */
+    cpu_set_t                   reservedCores;  /* the cores of the isolated groups */
+#endif
+
+    std::atomic<pxcI64>         injectedTotal;
+    std::atomic<Clock*>         clock;
+    std::atomic<pxcI64>         expired;
+};
@@ -26,6 +26,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #pragma once
 #include "service/pxcsessionservice.h"
+#include "service/pxcsyncpointservice.h"
 #include "pxcsyncpoint.h"
 
 /* scoreboarding and syncpoint services */
@@ -46,3 +47,81 @@ public:
     /* create sync point */
     virtual pxcStatus PXCAPI CreateSyncPoint(pxcI32 noutput, void** outputs, PXCSyncPoint **sp)=0;
 };
+
+/* optional batched scoreboarding, queried from the scheduler with QueryInstance */
+class PXCSchedulerBatchService:public PXCBase {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('S','C','H','B'));
+
+    /* MarkOutputs(noutput, outputs, PXC_STATUS_EXEC_INPROGRESS) followed by RequestInputs(ninput, inputs, cb), in one call */
+    virtual pxcStatus PXCAPI SubmitCallback(pxcI32 ninput, void** inputs, pxcI32 noutput, void** outputs, PXCSchedulerService::Callback *cb)=0;
+};
+
+/* optional timeline sync points, queried from the scheduler with QueryInstance */
+class PXCSchedulerTimelineService:public PXCBase {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('S','C','H','T'));
+
+    /* create a timeline sync point that starts at value */
+    virtual pxcStatus PXCAPI CreateTimeline(pxcI64 value, PXCTimelineSyncPoint **timeline)=0;
+};
+
+/* optional deadline scheduling, queried from the scheduler with QueryInstance */
+class PXCSchedulerDeadlineService:public PXCBase {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('S','C','H','D'));
+
+    /* the deadline of callbacks that never expire; deadlines are otherwise times of the clock */
+    PXC_DEFINE_CONST(NO_DEADLINE, -1);
+
+    /* the time base of the deadlines, in 100ns like the sample time stamps */
+    class Clock {
+    public:
+        virtual pxcI64 PXCAPI QueryTime(void)=0;
+    };
+
+    /* Replace the clock, for example with the device clock that stamps the samples; NULL restores
+       the default, a monotonic clock. Deadlines derived from sample time stamps need a clock on the
+       time base of the samples. The clock must outlive the scheduler or the next SetClock. */
+    virtual void PXCAPI SetClock(Clock *clock)=0;
+
+    /* Return the current time of the clock. */
+    virtual pxcI64 PXCAPI QueryTime(void)=0;
+
+    /* SubmitCallback with a deadline. Ready callbacks with deadlines run earliest deadline first,
+       ahead of callbacks without one; a callback that has not started by its deadline runs with
+       PXC_STATUS_EXEC_ABORTED instead, which sheds stale work under overload. */
+    virtual pxcStatus PXCAPI SubmitDeadline(pxcI32 ninput, void** inputs, pxcI32 noutput, void** outputs, PXCSchedulerService::Callback *cb, pxcI64 deadline)=0;
+};
+
+/* optional placement of callbacks on groups of worker threads, queried from the scheduler with QueryInstance */
+class PXCSchedulerPlacementService:public PXCBase {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('S','C','H','P'));
+
+    /* the group of the workers the scheduler starts with */
+    PXC_DEFINE_CONST(DEFAULT_GROUP, 0);
+
+    /**
+        @structure WorkerGroupInfo
+        Describes a group of worker threads.
+    */
+    struct WorkerGroupInfo {
+        pxcI32          nworkers;       /* the number of worker threads */
+        pxcI32          ncores;         /* the number of cores in cores, or zero to run on any core */
+        const pxcI32    *cores;         /* the cores the workers are pinned to */
+        pxcI32          numaNode;       /* the NUMA node the workers allocate memory from, or -1 for any node */
+        pxcBool         isolated;       /* the workers run no callbacks of the default group, and the default group
+                                           workers stay off the cores of the group */
+        pxcI32          reserved[3];
+    };
+
+    /* Start a group of workers. Callbacks submitted to the group run only on its workers. The workers
+       of groups that are not isolated run callbacks of the default group when their own run out. */
+    virtual pxcStatus PXCAPI CreateWorkerGroup(const WorkerGroupInfo *info, pxcI32 *group)=0;
+
+    /* SubmitDeadline, to run on the workers of group; pass PXCSchedulerDeadlineService::NO_DEADLINE
+       for no deadline. */
+    virtual pxcStatus PXCAPI SubmitToGroup(pxcI32 ninput, void** inputs, pxcI32 noutput, void** outputs, PXCSchedulerService::Callback *cb,
+        pxcI32 group, pxcI64 deadline)=0;
+};
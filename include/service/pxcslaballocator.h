@@ -0,0 +1,153 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcslaballocator.h
+    Defines PXCSlabAllocator, a per-type allocator with thread caches for small
+    objects that are created and released at frame rate, such as scheduler
+    callbacks.
+ */
+#pragma once
+#include "pxcbase.h"
+#include <mutex>
+#include <new>
+#include <stddef.h>
+
+/**
+    This class template allocates fixed size blocks for objects of type T. Blocks
+    are carved from slabs of SLAB_BLOCKS blocks and are never returned to the heap.
+    Each thread keeps up to CACHE_LIMIT free blocks, so allocation and release take
+    no lock; a thread moves half of its cache to or from the shared free list when
+    the cache overflows or runs empty. A block may be released on any thread.
+
+    Requests larger than T, from classes derived from T, go to the global heap.
+    Use the PXC_SLAB_ALLOCATED macro in the class definition to route the class
+    operator new and delete through the allocator.
+ */
+template <class T>
+class PXCSlabAllocator {
+public:
+    enum { CACHE_LIMIT = 64, SLAB_BLOCKS = 64, ALIGNMENT = 16 };
+    enum { BLOCK_SIZE = (sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT };
+
+    static void *Allocate(size_t size) {
+        if (size > BLOCK_SIZE) return ::operator new(size);
+        Cache &cache = ThreadCache();
+        if (!cache.head) Refill(cache);
+        Node *node = cache.head;
+        cache.head = node->next;
+        cache.count--;
+        return node;
+    }
+
+    static void Free(void *block, size_t size) {
+        if (!block) return;
+        if (size > BLOCK_SIZE) { ::operator delete(block); return; }
+        Cache &cache = ThreadCache();
+        Node *node = (Node*)block;
+        node->next = cache.head;
+        cache.head = node;
+        if (++cache.count > CACHE_LIMIT) Flush(cache, CACHE_LIMIT / 2);
+    }
+
+protected:
+
+    struct Node {
+        Node *next;
+    };
+
+    struct Shared {
+        std::mutex  mutex;
+        Node        *head;
+        int         count;
+        Shared(void):head(0),count(0) {}
+    };
+
+    struct Cache {
+        Node        *head;
+        int         count;
+        Cache(void):head(0),count(0) {}
+        ~Cache(void) { Flush(*this, count); }
+    };
+
+    /* The shared list outlives the thread caches that flush into it at exit. */
+    static Shared &SharedList(void) {
+        static Shared *shared = new Shared;
+        return *shared;
+    }
+
+    static Cache &ThreadCache(void) {
+        static thread_local Cache cache;
+        return cache;
+    }
+
+    /* Move up to half a cache of blocks from the shared list, or carve a new slab. */
+    static void Refill(Cache &cache) {
+        Shared &shared = SharedList();
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            for (; shared.head && cache.count < CACHE_LIMIT / 2; cache.count++, shared.count--) {
+                Node *node = shared.head;
+                shared.head = node->next;
+                node->next = cache.head;
+                cache.head = node;
+            }
+        }
+        if (cache.head) return;
+
+        char *slab = (char*)::operator new((size_t)BLOCK_SIZE * SLAB_BLOCKS);
+        for (int i = SLAB_BLOCKS - 1; i >= 0; i--) {
+            Node *node = (Node*)(slab + (size_t)i * BLOCK_SIZE);
+            node->next = cache.head;
+            cache.head = node;
+        }
+        cache.count += SLAB_BLOCKS;
+    }
+
+    /* Move n blocks from the cache to the shared list. */
+    static void Flush(Cache &cache, int n) {
+        if (n <= 0 || !cache.head) return;
+        Node *first = cache.head, *last = first;
+        int moved = 1;
+        for (; moved < n && last->next; moved++) last = last->next;
+        cache.head = last->next;
+        cache.count -= moved;
+
+        Shared &shared = SharedList();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        last->next = shared.head;
+        shared.head = first;
+        shared.count += moved;
+    }
+};
+
+/**
+    Declare the class operator new and delete to allocate from PXCSlabAllocator.
+    PXCBaseImpl and PXCAddRefImpl release objects with a class scoped delete, so
+    the matching operator delete is found from the virtual destructor.
+*/
+#define PXC_SLAB_ALLOCATED(CLASS) \
+    static void *operator new(size_t size) { return PXCSlabAllocator<CLASS>::Allocate(size); } \
+    static void operator delete(void *pthis, size_t size) { PXCSlabAllocator<CLASS>::Free(pthis, size); }
@@ -25,318 +25,314 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #pragma once
+#include "pxcimage.h"
 #include "service/pxcschedulerservice.h"
 #include "service/pxcsyncpointservice.h"
+#include "service/pxcslaballocator.h"
 
-template <class T, class Ti1, class To1>
-class PXCSmartAsyncImpl {
-public:
-
-    typedef pxcStatus (PXCAPI T::*TaskFunc)(Ti1 *i1, To1 *o1);
-    typedef pxcStatus (PXCAPI T::*AbortFunc)(pxcStatus sts);
-
-    static pxcStatus SubmitTask(Ti1 *i1, To1 *o1, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR* tname=0) {
-        PXCSyncPoint* sp2=(*sp)=0;
-        pxcStatus sts=scheduler2->CreateSyncPoint(1, (void**)&o1,&sp2);
-        if (sts<PXC_STATUS_NO_ERROR) return sts;
+/* Marks the input types of PXCSmartAsyncImplN */
+template <class... Ti> struct PXCAsyncInputs {};
 
-        CallbackImpl *ci=new CallbackImpl(i1,o1,sp2,instance,scheduler2,tfunc,afunc,tname);
-        if (!ci) {
-			sp2->Release();
-			return PXC_STATUS_ALLOC_FAILED;
-		}
-
-        sts=scheduler2->MarkOutputs(1,(void**)&o1,PXC_STATUS_EXEC_INPROGRESS);
-        if (sts<PXC_STATUS_NO_ERROR) {
-			ci->Release();
-			sp2->Release();
-			return sts;
-		}
+/* Marks the output types of PXCSmartAsyncImplN */
+template <class... To> struct PXCAsyncOutputs {};
 
-        sts=scheduler2->RequestInputs(1,(void**)&i1,ci);
-        if (sts<PXC_STATUS_NO_ERROR) {
-			ci->Release();
-			sp2->Release();
-			return sts;
-		}
+/* The abort handler of tasks submitted without one */
+struct PXCAsyncNoAbort {
+    pxcStatus operator()(pxcStatus) const { return PXC_STATUS_EXEC_ABORTED; }
+};
 
-        *sp=sp2;
-        return sts;
+/* The deadline of a task, in 100ns on the clock of PXCSchedulerDeadlineService. From an image,
+   the time stamp of the sample plus the latency budget of the module, which needs a scheduler clock
+   on the time base of the samples (see SetClock); an image without a time stamp has no deadline.
+   From the scheduler, its current time plus the budget. Schedulers without
+   PXCSchedulerDeadlineService ignore it. */
+struct PXCAsyncDeadline {
+    pxcI64 value;
+
+    explicit PXCAsyncDeadline(pxcI64 value = PXCSchedulerDeadlineService::NO_DEADLINE):value(value) {}
+    PXCAsyncDeadline(PXCImage *image, pxcI64 budget):value(PXCSchedulerDeadlineService::NO_DEADLINE) {
+        pxcI64 timeStamp = image ? image->QueryTimeStamp() : 0;
+        if (timeStamp) value = timeStamp + budget;
     }
+    PXCAsyncDeadline(PXCSchedulerService *scheduler, pxcI64 budget):value(PXCSchedulerDeadlineService::NO_DEADLINE) {
+        PXCSchedulerDeadlineService *edf = scheduler ? scheduler->QueryInstance<PXCSchedulerDeadlineService>() : 0;
+        if (edf) value = edf->QueryTime() + budget;
+    }
+};
 
-protected:
-
-    class CallbackImpl:public PXCBaseImpl<PXCSchedulerService::Callback> {
-    public:
-        CallbackImpl(Ti1 *i1, To1 *o1, PXCSyncPoint *sp, T *instance, PXCSchedulerService *scheduler, TaskFunc tfunc, AbortFunc afunc, const pxcCHAR* tname) {
-            this->instance=instance;
-            this->scheduler=scheduler;
-            this->sp=(PXCSyncPointService*)sp->QueryInstance(PXCSyncPointService::CUID);
-            sp->QueryInstance<PXCAddRef>()->AddRef();
-            this->tfunc=tfunc;    
-            this->afunc=afunc;
-            this->i1=i1;
-            this->o1=o1;
-            this->tname=tname;
-        }
-
-        virtual void PXCAPI Run(pxcStatus sts) {
-            if (sts<PXC_STATUS_NO_ERROR) {
-                sts=(afunc)?(instance->*afunc)(sts):PXC_STATUS_EXEC_ABORTED;
-            } else {
-                sts=(instance->*tfunc)(i1,o1);
-            }
-            scheduler->MarkOutputs(1,(void**)&o1,sts);
-            sp->SignalSyncPoint(sts);
-            sp->Release();
-            Release();
-        }
-
-        virtual const pxcCHAR* PXCAPI QueryCallbackName() { return tname; }
-
-    protected:
+/* Where and by when a task runs: the worker group of PXCSchedulerPlacementService, for example the
+   group of the module, and the deadline. Schedulers without PXCSchedulerPlacementService run the
+   task on any worker. */
+struct PXCAsyncPlacement {
+    pxcI32 group;
+    pxcI64 deadline;
 
-        T*              instance;
-        TaskFunc        tfunc;
-        AbortFunc        afunc;
-        PXCSchedulerService *scheduler;
-        PXCSyncPointService *sp;
-        Ti1*            i1;
-        To1*            o1;
-        const pxcCHAR*  tname;
-    };
+    PXCAsyncPlacement(const PXCAsyncDeadline &deadline):group(PXCSchedulerPlacementService::DEFAULT_GROUP),deadline(deadline.value) {}
+    PXCAsyncPlacement(pxcI32 group, const PXCAsyncDeadline &deadline = PXCAsyncDeadline()):group(group),deadline(deadline.value) {}
 };
 
-/* These are simplified asynchronous task handlers, for cases where I1 simutenously generates O1 & O2.
-   If I1->O1 and I1->O2 are not synchrnous, use the original scheduler functions for efficient signalling.
+template <int... I> struct PXCAsyncIndices {};
+template <int N, int... I> struct PXCAsyncMakeIndices:PXCAsyncMakeIndices<N-1, N-1, I...> {};
+template <int... I> struct PXCAsyncMakeIndices<0, I...> { typedef PXCAsyncIndices<I...> type; };
+
+/* Mark the outputs in progress and request the inputs, in one call if the scheduler supports batching,
+   and with the placement if the scheduler supports worker groups and deadlines. */
+__inline pxcStatus PXCSmartAsyncSubmit(PXCSchedulerService *scheduler, pxcI32 ninput, void **inputs, pxcI32 noutput, void **outputs, PXCSchedulerService::Callback *cb,
+        pxcI64 deadline = PXCSchedulerDeadlineService::NO_DEADLINE, pxcI32 group = PXCSchedulerPlacementService::DEFAULT_GROUP) {
+    if (group != PXCSchedulerPlacementService::DEFAULT_GROUP) {
+        PXCSchedulerPlacementService *placement = scheduler->QueryInstance<PXCSchedulerPlacementService>();
+        if (placement) return placement->SubmitToGroup(ninput, inputs, noutput, outputs, cb, group, deadline);
+    }
+    if (deadline != PXCSchedulerDeadlineService::NO_DEADLINE) {
+        PXCSchedulerDeadlineService *edf = scheduler->QueryInstance<PXCSchedulerDeadlineService>();
+        if (edf) return edf->SubmitDeadline(ninput, inputs, noutput, outputs, cb, deadline);
+    }
+    PXCSchedulerBatchService *batch = scheduler->QueryInstance<PXCSchedulerBatchService>();
+    if (batch) return batch->SubmitCallback(ninput, inputs, noutput, outputs, cb);
+    if (noutput > 0) {
+        pxcStatus sts = scheduler->MarkOutputs(noutput, outputs, PXC_STATUS_EXEC_INPROGRESS);
+        if (sts < PXC_STATUS_NO_ERROR) return sts;
+    }
+    return scheduler->RequestInputs(ninput, inputs, cb);
+}
+
+/* This is the asynchronous task handler for any number of inputs and outputs, for example
+   PXCSmartAsyncImplN<PXCAsyncInputs<PXCImage>, PXCAsyncOutputs<PXCImage, PXCBlobData> >.
+   The task runs once all inputs are ready, and its status marks all outputs and signals the SP.
+   The task is a member function of the module instance, or any function object or lambda that
+   takes the inputs followed by the outputs; the abort handler takes the error status of the
+   inputs and returns the status of the outputs. A task submitted with a deadline that has not
+   started when the deadline passes goes to the abort handler with PXC_STATUS_EXEC_ABORTED.
 */
-template <class T, class Ti1>
-class PXCSmartAsyncImplI1 {
+template <class Inputs, class Outputs>
+class PXCSmartAsyncImplN;
+
+template <class... Ti, class... To>
+class PXCSmartAsyncImplN<PXCAsyncInputs<Ti...>, PXCAsyncOutputs<To...> > {
 public:
+    enum { NINPUTS = sizeof...(Ti), NOUTPUTS = sizeof...(To) };
+
+    template <class T> static pxcStatus SubmitTask(Ti*... inputs, To*... outputs, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2,
+            pxcStatus (PXCAPI T::*tfunc)(Ti*..., To*...), pxcStatus (PXCAPI T::*afunc)(pxcStatus)=0, const pxcCHAR* tname=0) {
+        MemberTask<T> task = { instance, tfunc, afunc };
+        void *in[NINPUTS + 1] = { (void*)inputs..., 0 };
+        void *out[NOUTPUTS + 1] = { (void*)outputs..., 0 };
+        return Submit(in, out, sp, scheduler2, task, task, tname);
+    }
 
-    typedef pxcStatus (PXCAPI T::*TaskFunc)(Ti1 *i1);
-    typedef pxcStatus (PXCAPI T::*AbortFunc)(pxcStatus sts);
+    template <class F> static pxcStatus SubmitTask(Ti*... inputs, To*... outputs, PXCSyncPoint **sp, PXCSchedulerService *scheduler2, F tfunc, const pxcCHAR* tname=0) {
+        void *in[NINPUTS + 1] = { (void*)inputs..., 0 };
+        void *out[NOUTPUTS + 1] = { (void*)outputs..., 0 };
+        return Submit(in, out, sp, scheduler2, tfunc, PXCAsyncNoAbort(), tname);
+    }
 
-    static pxcStatus SubmitTask(Ti1 *i1, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR *tname=0) {
-        PXCSyncPoint* sp2=(*sp)=0;
-        pxcStatus sts=scheduler2->CreateSyncPoint(0,0,&sp2);
-        if (sts<PXC_STATUS_NO_ERROR) return sts;
+    template <class F, class A> static pxcStatus SubmitTask(Ti*... inputs, To*... outputs, PXCSyncPoint **sp, PXCSchedulerService *scheduler2, F tfunc, A afunc, const pxcCHAR* tname=0) {
+        void *in[NINPUTS + 1] = { (void*)inputs..., 0 };
+        void *out[NOUTPUTS + 1] = { (void*)outputs..., 0 };
+        return Submit(in, out, sp, scheduler2, tfunc, afunc, tname);
+    }
 
-        CallbackImpl *ci=new CallbackImpl(i1,sp2,instance,scheduler2,tfunc,afunc,tname);
-        if (!ci) {
-			sp2->Release();
-			return PXC_STATUS_ALLOC_FAILED;
-		}
+    /* The forms below run the task on the workers of a group, earliest deadline first, and abort
+       the task once the deadline passes. */
+    template <class T> static pxcStatus SubmitTask(Ti*... inputs, To*... outputs, PXCSyncPoint **sp, const PXCAsyncPlacement &placement, T *instance, PXCSchedulerService *scheduler2,
+            pxcStatus (PXCAPI T::*tfunc)(Ti*..., To*...), pxcStatus (PXCAPI T::*afunc)(pxcStatus)=0, const pxcCHAR* tname=0) {
+        MemberTask<T> task = { instance, tfunc, afunc };
+        void *in[NINPUTS + 1] = { (void*)inputs..., 0 };
+        void *out[NOUTPUTS + 1] = { (void*)outputs..., 0 };
+        return Submit(in, out, sp, scheduler2, task, task, tname, placement.deadline, placement.group);
+    }
 
-        sts=scheduler2->RequestInputs(1,(void**)&i1,ci);
-        if (sts<PXC_STATUS_NO_ERROR) {
-			ci->Release();
-			sp2->Release();
-			return sts;
-		}
+    template <class F> static pxcStatus SubmitTask(Ti*... inputs, To*... outputs, PXCSyncPoint **sp, const PXCAsyncPlacement &placement, PXCSchedulerService *scheduler2, F tfunc, const pxcCHAR* tname=0) {
+        void *in[NINPUTS + 1] = { (void*)inputs..., 0 };
+        void *out[NOUTPUTS + 1] = { (void*)outputs..., 0 };
+        return Submit(in, out, sp, scheduler2, tfunc, PXCAsyncNoAbort(), tname, placement.deadline, placement.group);
+    }
 
-        *sp=sp2;
-        return sts;
+    template <class F, class A> static pxcStatus SubmitTask(Ti*... inputs, To*... outputs, PXCSyncPoint **sp, const PXCAsyncPlacement &placement, PXCSchedulerService *scheduler2, F tfunc, A afunc, const pxcCHAR* tname=0) {
+        void *in[NINPUTS + 1] = { (void*)inputs..., 0 };
+        void *out[NOUTPUTS + 1] = { (void*)outputs..., 0 };
+        return Submit(in, out, sp, scheduler2, tfunc, afunc, tname, placement.deadline, placement.group);
     }
 
-protected:
+    /* The forms below signal value on a timeline instead of creating a sync point per task.
+       Signaling a value completes every value below it, so share a timeline only among tasks
+       that complete in order, such as the frames of one stream. */
+    template <class T> static pxcStatus SubmitTask(Ti*... inputs, To*... outputs, PXCTimelineSyncPoint *timeline, pxcI64 value, T *instance, PXCSchedulerService *scheduler2,
+            pxcStatus (PXCAPI T::*tfunc)(Ti*..., To*...), pxcStatus (PXCAPI T::*afunc)(pxcStatus)=0, const pxcCHAR* tname=0) {
+        MemberTask<T> task = { instance, tfunc, afunc };
+        void *in[NINPUTS + 1] = { (void*)inputs..., 0 };
+        void *out[NOUTPUTS + 1] = { (void*)outputs..., 0 };
+        return Submit(in, out, timeline, value, scheduler2, task, task, tname);
+    }
 
-    class CallbackImpl:public PXCBaseImpl<PXCSchedulerService::Callback> {
-    public:
-        CallbackImpl(Ti1 *i1, PXCSyncPoint *sp, T *instance, PXCSchedulerService *scheduler, TaskFunc tfunc, AbortFunc afunc, const pxcCHAR *tname) {
-            this->instance=instance;
-            this->scheduler=scheduler;
-            this->sp=(PXCSyncPointService*)sp->QueryInstance(PXCSyncPointService::CUID);
-            sp->QueryInstance<PXCAddRef>()->AddRef();
-            this->tfunc=tfunc;
-            this->afunc=afunc;
-            this->i1=i1;
-            this->tname = tname;
-        }
+    template <class F> static pxcStatus SubmitTask(Ti*... inputs, To*... outputs, PXCTimelineSyncPoint *timeline, pxcI64 value, PXCSchedulerService *scheduler2, F tfunc, const pxcCHAR* tname=0) {
+        void *in[NINPUTS + 1] = { (void*)inputs..., 0 };
+        void *out[NOUTPUTS + 1] = { (void*)outputs..., 0 };
+        return Submit(in, out, timeline, value, scheduler2, tfunc, PXCAsyncNoAbort(), tname);
+    }
 
-        virtual void PXCAPI Run(pxcStatus sts) {
-            if (sts<PXC_STATUS_NO_ERROR) {
-                sts=(afunc)?(instance->*afunc)(sts):PXC_STATUS_EXEC_ABORTED;
-            } else {
-                sts=(instance->*tfunc)(i1);
-            }
-            sp->SignalSyncPoint(sts);
-            sp->Release();
-            Release();
-        }
+    template <class F, class A> static pxcStatus SubmitTask(Ti*... inputs, To*... outputs, PXCTimelineSyncPoint *timeline, pxcI64 value, PXCSchedulerService *scheduler2, F tfunc, A afunc, const pxcCHAR* tname=0) {
+        void *in[NINPUTS + 1] = { (void*)inputs..., 0 };
+        void *out[NOUTPUTS + 1] = { (void*)outputs..., 0 };
+        return Submit(in, out, timeline, value, scheduler2, tfunc, afunc, tname);
+    }
 
-        virtual const pxcCHAR* PXCAPI QueryCallbackName(void) { return tname; }
+protected:
 
-    protected:
+    template <class T>
+    struct MemberTask {
+        T               *instance;
+        pxcStatus (PXCAPI T::*tfunc)(Ti*..., To*...);
+        pxcStatus (PXCAPI T::*afunc)(pxcStatus);
 
-        T*              instance;
-        TaskFunc        tfunc;
-        AbortFunc       afunc;
-        PXCSchedulerService *scheduler;
-        PXCSyncPointService *sp;
-        Ti1*            i1;
-        const pxcCHAR*  tname;
+        pxcStatus operator()(Ti*... inputs, To*... outputs) const { return (instance->*tfunc)(inputs..., outputs...); }
+        pxcStatus operator()(pxcStatus sts) const { return afunc ? (instance->*afunc)(sts) : PXC_STATUS_EXEC_ABORTED; }
     };
-};
-
-
-template <class T, class Ti1, class Ti2>
-class PXCSmartAsyncImplI2 {
-public:
-
-    typedef pxcStatus (PXCAPI T::*TaskFunc)(Ti1 *i1, Ti2 *i2);
-    typedef pxcStatus (PXCAPI T::*AbortFunc)(pxcStatus sts);
 
-    static pxcStatus SubmitTask(Ti1 *i1, Ti2 *i2, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR* tname=0) {
+    template <class F, class A>
+    static pxcStatus Submit(void **inputs, void **outputs, PXCSyncPoint **sp, PXCSchedulerService *scheduler2, const F &tfunc, const A &afunc, const pxcCHAR* tname,
+            pxcI64 deadline = PXCSchedulerDeadlineService::NO_DEADLINE, pxcI32 group = PXCSchedulerPlacementService::DEFAULT_GROUP) {
         PXCSyncPoint* sp2=(*sp)=0;
+        /* the callback signals the sync point, so it does not wait on the outputs */
         pxcStatus sts=scheduler2->CreateSyncPoint(0,0,&sp2);
         if (sts<PXC_STATUS_NO_ERROR) return sts;
 
-        CallbackImpl *ci=new CallbackImpl(i1,i2,sp2,instance,scheduler2,tfunc,afunc,tname);
+        CallbackImpl<F,A> *ci=new CallbackImpl<F,A>(inputs,outputs,sp2,0,0,scheduler2,tfunc,afunc,tname);
         if (!ci) {
-			sp2->Release();
-			return PXC_STATUS_ALLOC_FAILED;
-		}
+            sp2->Release();
+            return PXC_STATUS_ALLOC_FAILED;
+        }
 
-        void *inputs[2]={ i1, i2 };
-        sts=scheduler2->RequestInputs(2,inputs,ci);
+        sts=PXCSmartAsyncSubmit(scheduler2,NINPUTS,inputs,NOUTPUTS,outputs,ci,deadline,group);
         if (sts<PXC_STATUS_NO_ERROR) {
-			ci->Release();
-			sp2->Release();
-			return sts;
-		}
+            ci->Release();
+            sp2->Release();
+            return sts;
+        }
 
         *sp=sp2;
         return sts;
     }
 
-protected:
+    template <class F, class A>
+    static pxcStatus Submit(void **inputs, void **outputs, PXCTimelineSyncPoint *timeline, pxcI64 value, PXCSchedulerService *scheduler2, const F &tfunc, const A &afunc, const pxcCHAR* tname) {
+        if (!timeline) return PXC_STATUS_HANDLE_INVALID;
+        CallbackImpl<F,A> *ci=new CallbackImpl<F,A>(inputs,outputs,0,timeline,value,scheduler2,tfunc,afunc,tname);
+        if (!ci) return PXC_STATUS_ALLOC_FAILED;
 
+        pxcStatus sts=PXCSmartAsyncSubmit(scheduler2,NINPUTS,inputs,NOUTPUTS,outputs,ci);
+        if (sts<PXC_STATUS_NO_ERROR) ci->Release();
+        return sts;
+    }
+
+    template <class F, class A>
     class CallbackImpl:public PXCBaseImpl<PXCSchedulerService::Callback> {
     public:
-        CallbackImpl(Ti1 *i1, Ti2 *i2, PXCSyncPoint *sp, T *instance, PXCSchedulerService *scheduler, TaskFunc tfunc, AbortFunc afunc, const pxcCHAR* tname) {
-            this->instance=instance;
+        PXC_SLAB_ALLOCATED(CallbackImpl)
+
+        /* signals either the sync point sp or value on the timeline */
+        CallbackImpl(void **inputs, void **outputs, PXCSyncPoint *sp, PXCTimelineSyncPoint *timeline, pxcI64 value, PXCSchedulerService *scheduler, const F &tfunc, const A &afunc, const pxcCHAR* tname):tfunc(tfunc),afunc(afunc) {
             this->scheduler=scheduler;
-            this->sp=(PXCSyncPointService*)sp->QueryInstance(PXCSyncPointService::CUID);
-            sp->QueryInstance<PXCAddRef>()->AddRef();
-            this->tfunc=tfunc;
-            this->afunc=afunc;
-            this->i1=i1;
-            this->i2=i2;
+            this->sp=sp?(PXCSyncPointService*)sp->QueryInstance(PXCSyncPointService::CUID):0;
+            this->timeline=timeline;
+            this->value=value;
+            if (sp) sp->QueryInstance<PXCAddRef>()->AddRef();
+            if (timeline) timeline->QueryInstance<PXCAddRef>()->AddRef();
             this->tname=tname;
+            for (int i=0;i<NINPUTS;i++) this->inputs[i]=inputs[i];
+            for (int j=0;j<NOUTPUTS;j++) this->outputs[j]=outputs[j];
+        }
+
+        virtual ~CallbackImpl(void) {
+            if (sp) sp->Release();
+            if (timeline) timeline->Release();
         }
 
         virtual void PXCAPI Run(pxcStatus sts) {
             if (sts<PXC_STATUS_NO_ERROR) {
-                sts=(afunc)?(instance->*afunc)(sts):PXC_STATUS_EXEC_ABORTED;
+                sts=afunc(sts);
             } else {
-                sts=(instance->*tfunc)(i1,i2);
+                sts=Invoke(typename PXCAsyncMakeIndices<NINPUTS>::type(), typename PXCAsyncMakeIndices<NOUTPUTS>::type());
             }
-
-            sp->SignalSyncPoint(sts);
-            sp->Release();
+            if (NOUTPUTS>0) scheduler->MarkOutputs(NOUTPUTS,outputs,sts);
+            if (sp) sp->SignalSyncPoint(sts);
+            if (timeline) timeline->SignalValue(value,sts);
             Release();
         }
 
-        virtual const pxcCHAR* PXCAPI QueryCallbackName(void) { return tname; }
+        virtual const pxcCHAR* PXCAPI QueryCallbackName() { return tname; }
 
     protected:
 
-        T*              instance;
-        TaskFunc        tfunc;
-        AbortFunc       afunc;
+        template <int... I, int... J>
+        pxcStatus Invoke(PXCAsyncIndices<I...>, PXCAsyncIndices<J...>) {
+            return tfunc((Ti*)inputs[I]..., (To*)outputs[J]...);
+        }
+
+        F               tfunc;
+        A               afunc;
         PXCSchedulerService *scheduler;
         PXCSyncPointService *sp;
-        Ti1*            i1;
-        Ti2*            i2;
+        PXCTimelineSyncPoint *timeline;
+        pxcI64          value;
+        void*           inputs[NINPUTS + 1];
+        void*           outputs[NOUTPUTS + 1];
         const pxcCHAR*  tname;
     };
 };
 
-template <class T, class Ti1, class To1, class To2>
-class PXCSmartAsyncImplI1O2 {
+/* The fixed forms below are kept for existing modules; they submit through PXCSmartAsyncImplN. */
+template <class T, class Ti1, class To1>
+class PXCSmartAsyncImpl {
 public:
 
-    typedef pxcStatus (PXCAPI T::*TaskFunc)(Ti1 *i1, To1 *o1, To2 *o2);
+    typedef pxcStatus (PXCAPI T::*TaskFunc)(Ti1 *i1, To1 *o1);
     typedef pxcStatus (PXCAPI T::*AbortFunc)(pxcStatus sts);
 
-    static pxcStatus SubmitTask(Ti1 *i1, To1 *o1, To2 *o2, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR* tname=0) {
-        PXCSyncPoint* sp2=(*sp)=0;
-        void *outputs[2]={o1,o2};
-        pxcStatus sts=scheduler2->CreateSyncPoint(2,outputs,&sp2);
-        if (sts<PXC_STATUS_NO_ERROR) return sts;
-
-        CallbackImpl *ci=new CallbackImpl(i1,o1,o2,sp2,instance,scheduler2,tfunc,afunc,tname);
-        if (!ci) {
-			sp2->Release();
-			return PXC_STATUS_ALLOC_FAILED;
-		}
+    static pxcStatus SubmitTask(Ti1 *i1, To1 *o1, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR* tname=0) {
+        return PXCSmartAsyncImplN<PXCAsyncInputs<Ti1>, PXCAsyncOutputs<To1> >::SubmitTask(i1,o1,sp,instance,scheduler2,tfunc,afunc,tname);
+    }
+};
 
-        sts=scheduler2->MarkOutputs(2,outputs,PXC_STATUS_EXEC_INPROGRESS);
-        if (sts<PXC_STATUS_NO_ERROR) {
-			ci->Release();
-			sp2->Release();
-			return sts;
-		}
+/* These are simplified asynchronous task handlers, for cases where I1 simutenously generates O1 & O2.
+   If I1->O1 and I1->O2 are not synchrnous, use the original scheduler functions for efficient signalling.
+*/
+template <class T, class Ti1>
+class PXCSmartAsyncImplI1 {
+public:
 
-        sts=scheduler2->RequestInputs(1,(void**)&i1,ci);
-        if (sts<PXC_STATUS_NO_ERROR) {
-			ci->Release();
-			sp2->Release();
-			return sts;
-		}
+    typedef pxcStatus (PXCAPI T::*TaskFunc)(Ti1 *i1);
+    typedef pxcStatus (PXCAPI T::*AbortFunc)(pxcStatus sts);
 
-        *sp=sp2;
-        return sts;
+    static pxcStatus SubmitTask(Ti1 *i1, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR *tname=0) {
+        return PXCSmartAsyncImplN<PXCAsyncInputs<Ti1>, PXCAsyncOutputs<> >::SubmitTask(i1,sp,instance,scheduler2,tfunc,afunc,tname);
     }
+};
 
-protected:
+template <class T, class Ti1, class Ti2>
+class PXCSmartAsyncImplI2 {
+public:
 
-    class CallbackImpl:public PXCBaseImpl<PXCSchedulerService::Callback> {
-    public:
-        CallbackImpl(Ti1 *i1, To1 *o1, To2 *o2, PXCSyncPoint *sp, T *instance, PXCSchedulerService *scheduler, TaskFunc tfunc, AbortFunc afunc, const pxcCHAR* tname) {
-            this->instance=instance;
-            this->scheduler=scheduler;
-            this->sp=(PXCSyncPointService*)sp->QueryInstance(PXCSyncPointService::CUID);
-            sp->QueryInstance<PXCAddRef>()->AddRef();
-            this->tfunc=tfunc;
-            this->afunc=afunc;
-            this->i1=i1;
-            this->o1=o1;
-            this->o2=o2;
-            this->tname=tname;
-        }
+    typedef pxcStatus (PXCAPI T::*TaskFunc)(Ti1 *i1, Ti2 *i2);
+    typedef pxcStatus (PXCAPI T::*AbortFunc)(pxcStatus sts);
 
-        virtual void PXCAPI Run(pxcStatus sts) {
-            if (sts<PXC_STATUS_NO_ERROR) {
-                sts=(afunc)?(instance->*afunc)(sts):PXC_STATUS_EXEC_ABORTED;
-            } else {
-                sts=(instance->*tfunc)(i1,o1,o2);
-            }
-            void *outputs[2]={o1,o2};
-            scheduler->MarkOutputs(2,outputs,sts);
-            sp->SignalSyncPoint(sts);
-            sp->Release();
-            Release();
-        }
+    static pxcStatus SubmitTask(Ti1 *i1, Ti2 *i2, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR* tname=0) {
+        return PXCSmartAsyncImplN<PXCAsyncInputs<Ti1,Ti2>, PXCAsyncOutputs<> >::SubmitTask(i1,i2,sp,instance,scheduler2,tfunc,afunc,tname);
+    }
+};
 
-        virtual const pxcCHAR* PXCAPI QueryCallbackName() { return tname; }
+template <class T, class Ti1, class To1, class To2>
+class PXCSmartAsyncImplI1O2 {
+public:
 
-    protected:
+    typedef pxcStatus (PXCAPI T::*TaskFunc)(Ti1 *i1, To1 *o1, To2 *o2);
+    typedef pxcStatus (PXCAPI T::*AbortFunc)(pxcStatus sts);
 
-        T*              instance;
-        TaskFunc        tfunc;
-        AbortFunc       afunc;
-        PXCSchedulerService *scheduler;
-        PXCSyncPointService *sp;
-        Ti1*            i1;
-        To1*            o1;
-        To2*            o2;
-        const pxcCHAR*  tname;
-    };
+    static pxcStatus SubmitTask(Ti1 *i1, To1 *o1, To2 *o2, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR* tname=0) {
+        return PXCSmartAsyncImplN<PXCAsyncInputs<Ti1>, PXCAsyncOutputs<To1,To2> >::SubmitTask(i1,o1,o2,sp,instance,scheduler2,tfunc,afunc,tname);
+    }
 };
 
-
 template <class T, class Ti1, class Ti2, class To1>
 class PXCSmartAsyncImplI2O1 {
 public:
@@ -345,78 +341,8 @@ public:
     typedef pxcStatus (PXCAPI T::*AbortFunc)(pxcStatus sts);
 
     static pxcStatus SubmitTask(Ti1 *i1, Ti2 *i2, To1 *o1, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR* tname=0) {
-        PXCSyncPoint* sp2=(*sp)=0;
-        pxcStatus sts=scheduler2->CreateSyncPoint(1,(void**)&o1,&sp2);
-        if (sts<PXC_STATUS_NO_ERROR) return sts;
-
-        CallbackImpl *ci=new CallbackImpl(i1,i2,o1,sp2,instance,scheduler2,tfunc,afunc,tname);
-        if (!ci) {
-			sp2->Release();
-			return PXC_STATUS_ALLOC_FAILED;
-		}
-
-        sts=scheduler2->MarkOutputs(1,(void**)&o1,PXC_STATUS_EXEC_INPROGRESS);
-        if (sts<PXC_STATUS_NO_ERROR) {
-			ci->Release();
-			sp2->Release();
-			return sts;
-		}
-
-        void *inputs[2]={ i1, i2 };
-        sts=scheduler2->RequestInputs(2,inputs,ci);
-        if (sts<PXC_STATUS_NO_ERROR) {
-			ci->Release();
-			sp2->Release();
-			return sts;
-		}
-
-        *sp=sp2;
-        return sts;
+        return PXCSmartAsyncImplN<PXCAsyncInputs<Ti1,Ti2>, PXCAsyncOutputs<To1> >::SubmitTask(i1,i2,o1,sp,instance,scheduler2,tfunc,afunc,tname);
     }
-
-protected:
-
-    class CallbackImpl:public PXCBaseImpl<PXCSchedulerService::Callback> {
-    public:
-        CallbackImpl(Ti1 *i1, Ti2 *i2, To1 *o1, PXCSyncPoint *sp, T *instance, PXCSchedulerService *scheduler, TaskFunc tfunc, AbortFunc afunc, const pxcCHAR* tname) {
-            this->instance=instance;
-            this->scheduler=scheduler;
-            this->sp=(PXCSyncPointService*)sp->QueryInstance(PXCSyncPointService::CUID);
-            sp->QueryInstance<PXCAddRef>()->AddRef();
-            this->tfunc=tfunc;
-            this->afunc=afunc;
-            this->i1=i1;
-            this->i2=i2;
-            this->o1=o1;
-            this->tname=tname;
-        }
-
-        virtual void PXCAPI Run(pxcStatus sts) {
-            if (sts<PXC_STATUS_NO_ERROR) {
-                sts=(afunc)?(instance->*afunc)(sts):PXC_STATUS_EXEC_ABORTED;
-            } else {
-                sts=(instance->*tfunc)(i1,i2,o1);
-            }
-            scheduler->MarkOutputs(1,(void**)&o1,sts);
-            sp->SignalSyncPoint(sts);
-            sp->Release();
-            Release();
-        }
-
-        virtual const pxcCHAR* PXCAPI QueryCallbackName(void) { return tname; }
-
-    protected:
-
-        T*              instance;
-        TaskFunc        tfunc;
-        AbortFunc       afunc;
-        PXCSchedulerService *scheduler;
-        PXCSyncPointService *sp;
-        Ti1*            i1;
-        Ti2*            i2;
-        To1*            o1;
-        const pxcCHAR*  tname;
-    };
 };
 
 template <class T, class Ti, int TiX, class To, int ToY>
@@ -428,7 +354,8 @@ public:
 
     static pxcStatus SubmitTask(Ti *inputs[], pxcI32 ninputs, To *outputs[], pxcI32 noutputs, PXCSyncPoint **sp, T *instance, PXCSchedulerService *scheduler2, TaskFunc tfunc, AbortFunc afunc=0, const pxcCHAR* tname=0) {
         PXCSyncPoint* sp2=(*sp)=0;
-        pxcStatus sts=scheduler2->CreateSyncPoint(noutputs,(void**)outputs,&sp2);
+        /* the callback signals the sync point, so it does not wait on the outputs */
+        pxcStatus sts=scheduler2->CreateSyncPoint(0,0,&sp2);
         if (sts<PXC_STATUS_NO_ERROR) return sts;
 
         CallbackImpl* ci=new CallbackImpl(inputs,ninputs,outputs,noutputs,sp2,instance,scheduler2,tfunc,afunc,tname);
@@ -437,14 +364,7 @@ public:
 			return PXC_STATUS_ALLOC_FAILED;
 		}
 
-        sts=scheduler2->MarkOutputs(noutputs,(void**)outputs,PXC_STATUS_EXEC_INPROGRESS);
-        if (sts<PXC_STATUS_NO_ERROR) {
-			ci->Release();
-			sp2->Release();
-			return sts;
-		}
-
-        sts=scheduler2->RequestInputs(ninputs,(void**)inputs,ci);
+        sts=PXCSmartAsyncSubmit(scheduler2,ninputs,(void**)inputs,noutputs,(void**)outputs,ci);
         if (sts<PXC_STATUS_NO_ERROR) {
 			ci->Release();
 			sp2->Release();
@@ -459,6 +379,8 @@ protected:
 
     class CallbackImpl:public PXCBaseImpl<PXCSchedulerService::Callback> {
     public:
+        PXC_SLAB_ALLOCATED(CallbackImpl)
+
         CallbackImpl(Ti *inputs[], pxcI32 ninputs, To *outputs[], pxcI32 noutputs, PXCSyncPoint *sp, T *instance, PXCSchedulerService *scheduler, TaskFunc tfunc, AbortFunc afunc, const pxcCHAR* tname) {
             this->instance=instance;
             this->scheduler=scheduler;
@@ -472,6 +394,10 @@ protected:
             for (int j=0;j<(int)noutputs;j++) this->outputs[j]=outputs[j];
         }
 
+        virtual ~CallbackImpl(void) {
+            sp->Release();
+        }
+
         virtual void PXCAPI Run(pxcStatus sts) {
             if (sts<PXC_STATUS_NO_ERROR) {
                 sts=(afunc)?(instance->*afunc)(sts):PXC_STATUS_EXEC_ABORTED;
@@ -480,7 +406,6 @@ protected:
             }
             scheduler->MarkOutputs(noutputs,(void**)outputs,sts);
             sp->SignalSyncPoint(sts);
-            sp->Release();
             Release();
         }
 
@@ -518,7 +443,7 @@ public:
 			return PXC_STATUS_ALLOC_FAILED;
 		}
 
-        sts=scheduler2->RequestInputs(ninputs,(void**)inputs,ci);
+        sts=PXCSmartAsyncSubmit(scheduler2,ninputs,(void**)inputs,0,0,ci);
         if (sts<PXC_STATUS_NO_ERROR) {
 			ci->Release();
 			sp2->Release();
@@ -533,6 +458,8 @@ protected:
 
     class CallbackImpl:public PXCBaseImpl<PXCSchedulerService::Callback> {
     public:
+        PXC_SLAB_ALLOCATED(CallbackImpl)
+
         CallbackImpl(Ti *inputs[], pxcI32 ninputs, PXCSyncPoint *sp, T *instance, PXCSchedulerService *scheduler, TaskFunc tfunc, AbortFunc afunc, const pxcCHAR* tname) {
             this->instance=instance;
             this->scheduler=scheduler;
@@ -544,6 +471,10 @@ protected:
             for (int i=0;i<(int)ninputs;i++) this->inputs[i]=inputs[i];
         }
 
+        virtual ~CallbackImpl(void) {
+            sp->Release();
+        }
+
         virtual void PXCAPI Run(pxcStatus sts) {
             if (sts<PXC_STATUS_NO_ERROR) {
                 sts=(afunc)?(instance->*afunc)(sts):PXC_STATUS_EXEC_ABORTED;
@@ -551,7 +482,6 @@ protected:
                 sts=(instance->*tfunc)(inputs);
             }
             sp->SignalSyncPoint(sts);
-            sp->Release();
             Release();
         }
 
@@ -0,0 +1,172 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcsyncpointawait.h
+    Defines C++20 coroutine awaitables for PXCSyncPoint and for the asynchronous
+    module and capture calls. The definitions are empty when the compiler does
+    not support coroutines.
+ */
+#pragma once
+#include "pxcvideomodule.h"
+#include "pxccapturemanager.h"
+#include "service/pxcschedulerservice.h"
+#include "service/pxcsyncpointservice.h"
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#include <exception>
+
+/**
+    This class awaits a sync point; co_await returns the sync point status. The
+    awaiting coroutine is resumed as a callback of the executor, normally on one
+    of its worker threads, or directly on the signaling thread if the executor is
+    NULL. Sync points that do not support PXCSyncPointNotifyService block the
+    awaiting thread in Synchronize instead.
+
+    The awaiter does not release the sync point. It is neither copyable nor movable,
+    since the subscription and the resumer point back to it.
+ */
+class PXCSyncPointAwaiter:protected PXCSyncPointNotifyService::Handler {
+public:
+
+    explicit PXCSyncPointAwaiter(PXCSyncPoint *sp, PXCSchedulerService *executor = 0)
+        :sp(sp),executor(executor),status(PXC_STATUS_HANDLE_INVALID),resumer(this) {}
+
+    PXCSyncPointAwaiter(const PXCSyncPointAwaiter&) = delete;
+    PXCSyncPointAwaiter(PXCSyncPointAwaiter&&) = delete;
+    PXCSyncPointAwaiter& operator=(const PXCSyncPointAwaiter&) = delete;
+    PXCSyncPointAwaiter& operator=(PXCSyncPointAwaiter&&) = delete;
+
+    bool await_ready(void) const { return !sp; }
+
+    bool await_suspend(std::coroutine_handle<> coroutine) {
+        PXCSyncPointNotifyService *notify = sp->QueryInstance<PXCSyncPointNotifyService>();
+        if (!notify) {
+            status = sp->Synchronize();
+            return false;
+        }
+        handle = coroutine;
+        /* once subscribed, another thread may resume and destroy the coroutine; do not touch members */
+        pxcStatus sts = notify->SubscribeSignal(this);
+        if (sts == PXC_STATUS_EXEC_INPROGRESS) return true;
+        status = sts;
+        return false;
+    }
+
+    pxcStatus await_resume(void) const { return status; }
+
+protected:
+
+    /* Resumes the coroutine as a scheduler callback. The awaiter owns it; Release does nothing. */
+    class Resumer:public PXCBaseImpl<PXCSchedulerService::Callback> {
+    public:
+        explicit Resumer(PXCSyncPointAwaiter *awaiter):awaiter(awaiter) {}
+        virtual void PXCAPI Run(pxcStatus) { awaiter->handle.resume(); }
+        virtual void PXCAPI Release(void) {}
+    protected:
+        PXCSyncPointAwaiter *awaiter;
+    };
+
+    virtual void PXCAPI OnSignal(pxcStatus sts) {
+        status = sts;
+        if (executor && executor->RequestInputs(0, 0, &resumer) >= PXC_STATUS_NO_ERROR) return;
+        handle.resume();
+    }
+
+    PXCSyncPoint                *sp;
+    PXCSchedulerService         *executor;
+    pxcStatus                   status;
+    std::coroutine_handle<>     handle;
+    Resumer                     resumer;
+};
+
+/**
+    This class awaits the sync point of an asynchronous call and releases it when
+    destroyed. If the call failed, co_await returns its status without suspending.
+ */
+class PXCAsyncCallAwaiter:public PXCSyncPointAwaiter {
+public:
+
+    PXCAsyncCallAwaiter(pxcStatus sts, PXCSyncPoint *sp, PXCSchedulerService *executor = 0)
+        :PXCSyncPointAwaiter(sts < PXC_STATUS_NO_ERROR ? 0 : sp, executor),owned(sp) {
+        if (sts < PXC_STATUS_NO_ERROR || !sp) status = sts < PXC_STATUS_NO_ERROR ? sts : PXC_STATUS_HANDLE_INVALID;
+    }
+
+    PXCAsyncCallAwaiter(const PXCAsyncCallAwaiter&) = delete;
+    PXCAsyncCallAwaiter(PXCAsyncCallAwaiter&&) = delete;
+    PXCAsyncCallAwaiter& operator=(const PXCAsyncCallAwaiter&) = delete;
+    PXCAsyncCallAwaiter& operator=(PXCAsyncCallAwaiter&&) = delete;
+
+    ~PXCAsyncCallAwaiter(void) { if (owned) owned->Release(); }
+
+protected:
+    PXCSyncPoint *owned;
+};
+
+/**
+    @brief Await PXCVideoModule::ProcessImageAsync.
+    @return The awaitable; co_await returns the processing status.
+*/
+__inline PXCAsyncCallAwaiter PXCAwaitProcessImage(PXCVideoModule *module, PXCCapture::Sample *sample, PXCSchedulerService *executor = 0) {
+    PXCSyncPoint *sp = 0;
+    pxcStatus sts = module ? module->ProcessImageAsync(sample, &sp) : PXC_STATUS_HANDLE_INVALID;
+    return PXCAsyncCallAwaiter(sts, sp, executor);
+}
+
+/**
+    @brief Await PXCCapture::Device::ReadStreamsAsync.
+    @return The awaitable; co_await returns the read status.
+*/
+__inline PXCAsyncCallAwaiter PXCAwaitReadStreams(PXCCapture::Device *device, PXCCapture::StreamType scope, PXCCapture::Sample *sample, PXCSchedulerService *executor = 0) {
+    PXCSyncPoint *sp = 0;
+    pxcStatus sts = device ? device->ReadStreamsAsync(scope, sample, &sp) : PXC_STATUS_HANDLE_INVALID;
+    return PXCAsyncCallAwaiter(sts, sp, executor);
+}
+
+/**
+    @brief Await PXCCaptureManager::ReadModuleStreamsAsync.
+    @return The awaitable; co_await returns the read status.
+*/
+__inline PXCAsyncCallAwaiter PXCAwaitReadModuleStreams(PXCCaptureManager *captureManager, pxcUID mid, PXCCapture::Sample *sample, PXCSchedulerService *executor = 0) {
+    PXCSyncPoint *sp = 0;
+    pxcStatus sts = captureManager ? captureManager->ReadModuleStreamsAsync(mid, sample, &sp) : PXC_STATUS_HANDLE_INVALID;
+    return PXCAsyncCallAwaiter(sts, sp, executor);
+}
+
+/**
+    The return type of a fire-and-forget coroutine. The coroutine starts running
+    on the calling thread and frees its frame when it finishes.
+ */
+struct PXCAsyncCoroutine {
+    struct promise_type {
+        PXCAsyncCoroutine get_return_object(void) { return PXCAsyncCoroutine(); }
+        std::suspend_never initial_suspend(void) noexcept { return std::suspend_never(); }
+        std::suspend_never final_suspend(void) noexcept { return std::suspend_never(); }
+        void return_void(void) {}
+        void unhandled_exception(void) { std::terminate(); }
+    };
+};
+
+#endif
@@ -34,3 +34,48 @@ public:
 
     virtual pxcStatus PXCAPI SignalSyncPoint(pxcStatus status)=0;
 };
+
+/* optional completion notification, queried from the sync point with QueryInstance */
+class PXCSyncPointNotifyService:public PXCBase {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('S','Y','N','N'));
+
+    class Handler {
+    public:
+        virtual void PXCAPI OnSignal(pxcStatus status)=0;
+    };
+
+    /* Call handler->OnSignal once, on the signaling thread, when the sync point is signaled.
+       Returns PXC_STATUS_EXEC_INPROGRESS if subscribed, or the status if already signaled,
+       in which case the handler is not called. */
+    virtual pxcStatus PXCAPI SubscribeSignal(Handler *handler)=0;
+
+    /* Withdraw a subscription. Returns PXC_STATUS_ITEM_UNAVAILABLE if the handler is not
+       subscribed, for example because the notification is already under way. */
+    virtual pxcStatus PXCAPI UnsubscribeSignal(Handler *handler)=0;
+};
+
+/* Timeline sync point: a monotonically increasing value per stream or module, for example the
+   frame index. The producer signals each value once it is done, instead of creating and
+   releasing a sync point per frame, and consumers wait for the value they need. */
+class PXCTimelineSyncPoint:public PXCBase {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('S','Y','N','T'));
+
+    /* Return the value reached so far. */
+    virtual pxcI64 PXCAPI QueryValue(void)=0;
+
+    /* Advance the timeline to value, which completes every value up to it. Returns
+       PXC_STATUS_PARAM_UNSUPPORTED if value is not above the current value. A signal with an
+       error status completes the values it advances over with that error; later signals
+       complete their values with their own status. */
+    virtual pxcStatus PXCAPI SignalValue(pxcI64 value, pxcStatus status)=0;
+
+    /* Wait until the timeline reaches value. Returns the status of value, or
+       PXC_STATUS_EXEC_TIMEOUT. */
+    virtual pxcStatus PXCAPI WaitFor(pxcI64 value, pxcI32 timeout)=0;
+
+    /* Create a PXCSyncPoint, with PXCSyncPointNotifyService, that completes when the timeline
+       reaches value, for callers that wait on sync points. */
+    virtual pxcStatus PXCAPI CreateSyncPoint(pxcI64 value, PXCSyncPoint **sp)=0;
+};
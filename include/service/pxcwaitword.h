@@ -0,0 +1,118 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcwaitword.h
+    Defines PXCWaitWord, an atomic integer that threads can sleep on until it
+    changes: a futex on Linux, and a mutex with a condition variable elsewhere.
+ */
+#pragma once
+#include "pxcdefs.h"
+#include <atomic>
+#include <chrono>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+/**
+    This class is an atomic integer with a wait operation. Store wakes every
+    waiting thread, and skips the wake when none is waiting, so an uncontended
+    Store costs one atomic store and one load.
+ */
+class PXCWaitWord {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit PXCWaitWord(int value = 0):value(value),sleepers(0) {}
+
+    int Load(void) const { return value.load(); }
+
+    void Store(int newValue) {
+        value.store(newValue);
+        if (!sleepers.load()) return;
+#if defined(__linux__)
+        syscall(SYS_futex, (int*)&value, FUTEX_WAKE_PRIVATE, 0x7FFFFFFF, 0, 0, 0);
+#else
+        std::lock_guard<std::mutex> lock(mutex);
+        changed.notify_all();
+#endif
+    }
+
+    /**
+        @brief Wait while the value equals the expected value.
+        @param[in] expected     The value to wait out.
+        @param[in] deadline     The time to give up, or NULL to wait without limit.
+        @return true if the value changed, false if the deadline passed.
+    */
+    bool Wait(int expected, const Clock::time_point *deadline = 0) {
+        bool changedValue = true;
+        sleepers.fetch_add(1);
+#if defined(__linux__)
+        while (value.load() == expected) {
+            struct timespec ts, *timeout = 0;
+            if (deadline) {
+                pxcI64 left = std::chrono::duration_cast<std::chrono::nanoseconds>(*deadline - Clock::now()).count();
+                if (left <= 0) { changedValue = false; break; }
+                ts.tv_sec = (time_t)(left / 1000000000);
+                ts.tv_nsec = (long)(left % 1000000000);
+                timeout = &ts;
+            }
+            syscall(SYS_futex, (int*)&value, FUTEX_WAIT_PRIVATE, expected, timeout, 0, 0);
+        }
+#else
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (value.load() == expected) {
+                if (!deadline) {
+                    changed.wait(lock);
+                } else if (changed.wait_until(lock, *deadline) == std::cv_status::timeout) {
+                    changedValue = value.load() != expected;
+                    break;
+                }
+            }
+        }
+#endif
+        sleepers.fetch_sub(1);
+        return changedValue;
+    }
+
+protected:
+    std::atomic<int>            value;
+    std::atomic<int>            sleepers;
+#if !defined(__linux__)
+    std::mutex                  mutex;
+    std::condition_variable     changed;
+#endif
+
+private:
+    PXCWaitWord(const PXCWaitWord&);
+    PXCWaitWord& operator=(const PXCWaitWord&);
+};
@@ -0,0 +1,149 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/** @file pxcworkstealingdeque.h
+    Defines PXCWorkStealingDeque, the lock-free per-worker task deque of
+    PXCSchedulerImpl.
+ */
+#pragma once
+#include "pxcdefs.h"
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+/**
+    This class template is a Chase-Lev work-stealing deque of pointers. The owner
+    thread pushes and takes at the bottom, in LIFO order; any other thread steals
+    from the top, in FIFO order. The ring grows by doubling when full; retired rings
+    are kept until the deque is destroyed, since a concurrent thief may still read
+    them.
+ */
+template <class T>
+class PXCWorkStealingDeque {
+public:
+
+    explicit PXCWorkStealingDeque(pxcI64 capacity = 256):top(0),bottom(0) {
+        pxcI64 size = 1;
+        while (size < capacity) size <<= 1;
+        ring.store(new Ring(size), std::memory_order_relaxed);
+    }
+
+    ~PXCWorkStealingDeque(void) {
+        delete ring.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < retired.size(); i++) delete retired[i];
+    }
+
+    /**
+        @brief Push an item at the bottom. Only the owner thread may call this function.
+    */
+    void Push(T *item) {
+        pxcI64 b = bottom.load(std::memory_order_relaxed);
+        pxcI64 t = top.load(std::memory_order_acquire);
+        Ring *r = ring.load(std::memory_order_relaxed);
+        if (b - t > r->mask) r = Grow(r, t, b);
+        r->Put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /**
+        @brief Take the most recently pushed item. Only the owner thread may call this function.
+        @return The item, or NULL if the deque is empty.
+    */
+    T* Take(void) {
+        pxcI64 b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring *r = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        pxcI64 t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return 0;
+        }
+        T *item = r->Get(b);
+        if (t == b) {
+            /* the last item; race the thieves for it */
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) item = 0;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /**
+        @brief Steal the least recently pushed item. Any thread may call this function.
+        @return The item, or NULL if the deque is empty or another thread won the race.
+    */
+    T* Steal(void) {
+        pxcI64 t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        pxcI64 b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return 0;
+        T *item = ring.load(std::memory_order_acquire)->Get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return 0;
+        return item;
+    }
+
+    /**
+        @brief Return the number of items. The value is a snapshot when other threads are active.
+    */
+    pxcI64 QuerySize(void) const {
+        pxcI64 b = bottom.load(std::memory_order_relaxed);
+        pxcI64 t = top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+protected:
+
+    struct Ring {
+        pxcI64                      mask;
+        std::atomic<T*>             *items;
+
+        explicit Ring(pxcI64 size):mask(size - 1),items(new std::atomic<T*>[size]) {}
+        ~Ring(void) { delete[] items; }
+
+        T*   Get(pxcI64 i) const { return items[i & mask].load(std::memory_order_relaxed); }
+        void Put(pxcI64 i, T *item) { items[i & mask].store(item, std::memory_order_relaxed); }
+    };
+
+    Ring* Grow(Ring *r, pxcI64 t, pxcI64 b) {
+        Ring *grown = new Ring((r->mask + 1) * 2);
+        for (pxcI64 i = t; i < b; i++) grown->Put(i, r->Get(i));
+        retired.push_back(r);
+        ring.store(grown, std::memory_order_release);
+        return grown;
+    }
+
+    /* top and bottom are written by different threads; keep them on separate cache lines */
+    std::atomic<pxcI64>     top;
+    char                    padding[64 - sizeof(pxcI64)];
+    std::atomic<pxcI64>     bottom;
+    std::atomic<Ring*>      ring;
+    std::vector<Ring*>      retired;
+
+private:
+    PXCWorkStealingDeque(const PXCWorkStealingDeque&);
+    PXCWorkStealingDeque& operator=(const PXCWorkStealingDeque&);
+};
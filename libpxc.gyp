@@ -33,6 +33,7 @@
         'include/pxchanddata.h',
         'include/pxchandmodule.h',
         'include/pxcimage.h',
+        'include/pxcimagepyramid.h',
         'include/pxcmetadata.h',
         'include/pxcobjectrecognitionconfiguration.h',
         'include/pxcobjectrecognitiondata.h',
@@ -44,6 +45,7 @@
         'include/pxcplatformcameracontrol.h',
         'include/pxcpowerstate.h',
         'include/pxcprojection.h',
+        'include/pxcptr.h',
         'include/pxcsceneperception.h',
         'include/pxcsensemanager.h',
         'include/pxcsession.h',
@@ -57,14 +59,71 @@
         'include/pxcversion.h',
         'include/pxcvideomodule.h',
         'include/service/pxcaudiosourceservice.h',
+        'include/service/pxcimageconversion.h',
+        'include/service/pxcimageimpl.h',
+        'include/service/pxcimagerotation.h',
+        'include/service/pxcimagescaling.h',
+        'include/service/pxcimplindex.h',
+        'include/service/pxcimplregistry.h',
         'include/service/pxcloggingservice.h',
         'include/service/pxcpowerstateserviceclient.h',
+        'include/service/pxcschedulerimpl.h',
         'include/service/pxcschedulerservice.h',
         'include/service/pxcserializableservice.h',
         'include/service/pxcsessionservice.h',
+        'include/service/pxcslaballocator.h',
         'include/service/pxcsmartasyncimpl.h',
+        'include/service/pxcsyncpointawait.h',
         'include/service/pxcsyncpointservice.h',
+        'include/service/pxcwaitword.h',
+        'include/service/pxcworkstealingdeque.h',
         'src/libpxc/libpxc.cpp',
+        'src/libpxc/pxcimageconversion.cpp',
+        'src/libpxc/pxcimagerotation.cpp',
+        'src/libpxc/pxcimagescaling.cpp',
+        'src/libpxc/pxcsimd.h',
+      ],
+      'include_dirs': [
+        'include',
+      ],
+      'conditions': [
+        ['OS=="linux"', {
+          'link_settings': {
+            'libraries': [
+              '-ldl',
+            ],
+          },
+        }],
+      ]
+    },
+    {
+      'target_name': 'pxcimageconversion_test',
+      'type': 'executable',
+      'dependencies': [
+        'libpxc',
+      ],
+      'sources': [
+        'test/pxcimageconversion_test.cpp',
+      ],
+      'include_dirs': [
+        'include',
+      ]
+    },
+    {
+      'target_name': 'pxcaddref_benchmark',
+      'type': 'executable',
+      'sources': [
+        'test/pxcaddref_benchmark.cpp',
+      ],
+      'include_dirs': [
+        'include',
+      ]
+    },
+    {
+      'target_name': 'pxcaddref_stress_test',
+      'type': 'executable',
+      'sources': [
+        'test/pxcaddref_stress_test.cpp',
       ],
       'include_dirs': [
         'include',
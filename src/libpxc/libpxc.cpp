@@ -24,13 +24,47 @@ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
+#if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
 #include <tchar.h>
+#else
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
 
 // In order to avoid linking to STD runtime for libpxc.lib we are not using types defined in PXC API
 //#include "pxcsession.h"
 #include "pxcversion.h"
 
+#define PRINT_INFO(PARAMS)
+
+#if defined(_WIN32) || defined(_WIN64)
+#define PXCAPI __stdcall
+#else
+#define PXCAPI
+#endif
+
+class PXCSession;
+
+extern "C" PXCSession* PXCAPI PXCSession_Create(void);
+
+typedef int (PXCAPI *FUNC_PXCSession_CreateExt)(int version_major, int version_minor, int version_build, int reserved, int options, int reserved2, PXCSession **instance);
+
+/* The session library is resolved once per process. Later calls go straight to the cached entry point. */
+static FUNC_PXCSession_CreateExt g_pPXCSession_CreateExt = 0;
+static int g_sessionOptions = 0;
+
+static PXCSession *CreateSessionCached(void) {
+    PXCSession *instance = 0;
+    int sts = (*g_pPXCSession_CreateExt)(PXC_VERSION_MAJOR, PXC_VERSION_MINOR, PXC_VERSION_BUILD, 0, g_sessionOptions, 0, &instance);
+    return (sts >= 0 /*PXC_STATUS_NO_ERROR*/) ? instance : 0;
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+
 #define RSSDK_REG_MAIN       TEXT("Core")
 #define RSSDK_REG_LOCAL      TEXT("LocalRuntime")
 
@@ -42,14 +76,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define SESSION_RELATIVE_PATH  (sizeof(void*) == 4 ? L"\\bin\\win32\\libpxcsession.dll" : L"\\bin\\x64\\libpxcsession.dll")
 #endif
 
-#define PRINT_INFO(PARAMS)
-
-#define PXCAPI __stdcall
-
-class PXCSession;
-
-extern "C" PXCSession* PXCAPI PXCSession_Create(void);
-
 static PXCSession *LoadSessionLibrary(wchar_t *filepath, int options) {
 	PXCSession *instance = 0;
 	int sts = -1; // PXC_STATUS_FEATURE_UNSUPPORTED;
@@ -57,11 +83,14 @@ static PXCSession *LoadSessionLibrary(wchar_t *filepath, int options) {
     if (module) {
         PRINT_INFO((L"The SDK INFO: Loading session library %s\n", filepath));
 
-        typedef int (PXCAPI *FUNC_PXCSession_CreateExt)(int version_major, int version_minor, int version_build, int reserved, int options, int reserved2, PXCSession **instance);
         FUNC_PXCSession_CreateExt pPXCSession_CreateExt = (FUNC_PXCSession_CreateExt)GetProcAddress(module, "PXCSession_CreateExt");
         if (pPXCSession_CreateExt) {
             sts = (*pPXCSession_CreateExt)(PXC_VERSION_MAJOR, PXC_VERSION_MINOR, PXC_VERSION_BUILD, 0, options, 0, &instance);
         }
+        if (sts >= 0 /*PXC_STATUS_NO_ERROR*/) {
+            g_sessionOptions = options;
+            InterlockedExchangePointer((PVOID volatile*)&g_pPXCSession_CreateExt, (PVOID)pPXCSession_CreateExt);
+        }
     }
     if (sts >= 0 /*PXC_STATUS_NO_ERROR*/)
     {
@@ -75,6 +104,8 @@ static PXCSession *LoadSessionLibrary(wchar_t *filepath, int options) {
 
 
 PXCSession* PXCAPI PXCSession_Create(void) {
+    if (g_pPXCSession_CreateExt) return CreateSessionCached();
+
     LONG err_code;
     HKEY key = 0;
     DWORD type = 0;
@@ -140,3 +171,121 @@ PXCSession* PXCAPI PXCSession_Create(void) {
 	    return 0;
     }
 }
+
+#else
+
+#define SESSION_LIBRARY_NAME        "libpxcsession.so"
+#define SESSION_ENV_LIBRARY         "RSSDK_SESSION_LIBRARY"
+#define SESSION_ENV_LOCAL           "RSSDK_LOCAL_RUNTIME"
+#define SESSION_ENV_CONFIG          "RSSDK_DISPATCH_CONFIG"
+#define SESSION_CONFIG_FILE         "/etc/rssdk/v8/dispatch.conf"
+#define SESSION_CONFIG_MAIN         "Core"
+#define SESSION_PATH_MAX            4096
+
+static pthread_mutex_t g_sessionLock = PTHREAD_MUTEX_INITIALIZER;
+
+static PXCSession *LoadSessionLibrary(const char *filepath, int options) {
+    PXCSession *instance = 0;
+    int sts = -1; // PXC_STATUS_FEATURE_UNSUPPORTED;
+    void *module = dlopen(filepath, RTLD_NOW | RTLD_LOCAL);
+    if (module) {
+        PRINT_INFO(("The SDK INFO: Loading session library %s\n", filepath));
+
+        FUNC_PXCSession_CreateExt pPXCSession_CreateExt = (FUNC_PXCSession_CreateExt)dlsym(module, "PXCSession_CreateExt");
+        if (pPXCSession_CreateExt) {
+            sts = (*pPXCSession_CreateExt)(PXC_VERSION_MAJOR, PXC_VERSION_MINOR, PXC_VERSION_BUILD, 0, options, 0, &instance);
+        }
+        if (sts >= 0 /*PXC_STATUS_NO_ERROR*/) {
+            /* keep the library loaded for the lifetime of the process, as on Windows */
+            g_sessionOptions = options;
+            __atomic_store_n(&g_pPXCSession_CreateExt, pPXCSession_CreateExt, __ATOMIC_RELEASE);
+        } else {
+            dlclose(module);
+        }
+    }
+    if (sts >= 0 /*PXC_STATUS_NO_ERROR*/)
+    {
+        PRINT_INFO(("The SDK INFO: Loaded session library: %s\n", filepath));
+    } else
+    {
+        PRINT_INFO(("The SDK INFO: FAILED to load session library: %s\n", filepath));
+    }
+    return instance;
+}
+
+/* Read the "Core=<path>" entry from the dispatch configuration file. */
+static bool ReadDispatchConfig(const char *filename, char *path, size_t size) {
+    FILE *file = fopen(filename, "r");
+    if (!file) return false;
+
+    bool found = false;
+    char line[SESSION_PATH_MAX];
+    while (!found && fgets(line, sizeof(line), file)) {
+        char *key = line;
+        while (*key == ' ' || *key == '\t') key++;
+        if (*key == '#' || strncmp(key, SESSION_CONFIG_MAIN, sizeof(SESSION_CONFIG_MAIN) - 1)) continue;
+
+        char *value = key + sizeof(SESSION_CONFIG_MAIN) - 1;
+        while (*value == ' ' || *value == '\t') value++;
+        if (*value++ != '=') continue;
+        while (*value == ' ' || *value == '\t') value++;
+
+        size_t len = strcspn(value, "\r\n");
+        while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t')) len--;
+        if (!len || len >= size) continue;
+
+        memcpy(path, value, len);
+        path[len] = 0;
+        found = true;
+    }
+    fclose(file);
+    return found;
+}
+
+static PXCSession *LoadSessionLibraryFromSearchPath(void) {
+    // explicit library path overrides everything else
+    const char *library = getenv(SESSION_ENV_LIBRARY);
+    if (library && library[0]) {
+        PXCSession *session = LoadSessionLibrary(library, 1);
+        if (session) return session;
+    }
+
+    // local runtime folder, the equivalent of the LocalRuntime registry key
+    const char *local_path = getenv(SESSION_ENV_LOCAL);
+    if (local_path && local_path[0]) {
+        char filepath[SESSION_PATH_MAX];
+        int len = snprintf(filepath, sizeof(filepath), "%s/" SESSION_LIBRARY_NAME, local_path);
+        if (len > 0 && len < (int)sizeof(filepath)) {
+            PXCSession *session = LoadSessionLibrary(filepath, 1);
+            if (session) return session;
+        }
+    }
+
+    // dispatch configuration written by the runtime installer
+    const char *config = getenv(SESSION_ENV_CONFIG);
+    char dll_path[SESSION_PATH_MAX] = "";
+    if (ReadDispatchConfig((config && config[0]) ? config : SESSION_CONFIG_FILE, dll_path, sizeof(dll_path))) {
+        PRINT_INFO(("The SDK INFO: Loading core library from path specified in %s\n", SESSION_CONFIG_FILE));
+        PXCSession *session = LoadSessionLibrary(dll_path, 0);
+        if (session) return session;
+    }
+
+    // finally let the dynamic linker search LD_LIBRARY_PATH and the system folders
+    return LoadSessionLibrary(SESSION_LIBRARY_NAME, 0);
+}
+
+PXCSession* PXCAPI PXCSession_Create(void) {
+    if (__atomic_load_n(&g_pPXCSession_CreateExt, __ATOMIC_ACQUIRE)) return CreateSessionCached();
+
+    pthread_mutex_lock(&g_sessionLock);
+    PXCSession *session = 0;
+    if (g_pPXCSession_CreateExt) {
+        session = CreateSessionCached();
+    } else {
+        session = LoadSessionLibraryFromSearchPath();
+    }
+    pthread_mutex_unlock(&g_sessionLock);
+    return session;
+}
+
+#endif
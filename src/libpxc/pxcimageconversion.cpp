@@ -0,0 +1,1198 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "service/pxcimageconversion.h"
+#include "pxcsimd.h"
+#include <atomic>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+   Color conversions use the BT.601 limited range integer transform:
+
+   R = clamp((298*(Y-16) + 409*(V-128) + 128) >> 8)
+   G = clamp((298*(Y-16) - 100*(U-128) - 208*(V-128) + 128) >> 8)
+   B = clamp((298*(Y-16) + 516*(U-128) + 128) >> 8)
+
+   Y = ((66*R + 129*G + 25*B + 128) >> 8) + 16
+   U = ((-38*R - 74*G + 112*B + 128) >> 8) + 128
+   V = ((112*R - 94*G - 18*B + 128) >> 8) + 128
+
+   Depth conversions scale by a single-precision factor derived from the depth
+   unit (micrometers per DEPTH_RAW unit) and round to nearest even. Zero, the
+   invalid depth value, stays zero; NaN and non-positive DEPTH_F32 values map to
+   zero and values beyond 65535 saturate.
+
+   IR conversions to Y8 stretch the source linearly between two limits:
+
+   Y8 = clamp(round((v - low) * 255 / (high - low)))
+
+   The SIMD kernels evaluate the same expressions in 32-bit lanes, so their
+   output is bit-exact with the scalar reference kernels below.
+*/
+
+typedef PXCImage::ImageData ImageData;
+
+static inline pxcBYTE Clamp8(int v) {
+    return (pxcBYTE)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static inline void YuvToBgra(int y, int u, int v, pxcBYTE *bgra) {
+    int c = (y - 16) * 298 + 128, d = u - 128, e = v - 128;
+    bgra[0] = Clamp8((c + 516 * d) >> 8);
+    bgra[1] = Clamp8((c - (100 * d + 208 * e)) >> 8);
+    bgra[2] = Clamp8((c + 409 * e) >> 8);
+    bgra[3] = 255;
+}
+
+static inline int BgrToY(int b, int g, int r) { return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16; }
+static inline int BgrToU(int b, int g, int r) { return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128; }
+static inline int BgrToV(int b, int g, int r) { return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128; }
+
+static inline pxcI32 Load32(const pxcBYTE *p) {
+    pxcI32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void Store32(pxcBYTE *p, pxcI32 v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+/* scalar reference kernels; the SIMD kernels call them for the row tails */
+
+static void Yuy2ToBgra_C(const pxcBYTE *src, pxcBYTE *dst, int x, int width) {
+    for (; x < width; x++) {
+        const pxcBYTE *pair = src + (x & ~1) * 2;
+        YuvToBgra(pair[(x & 1) * 2], pair[1], pair[3], dst + x * 4);
+    }
+}
+
+static void Nv12ToBgra_C(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int x, int width) {
+    for (; x < width; x++)
+        YuvToBgra(y[x], uv[x & ~1], uv[(x & ~1) + 1], dst + x * 4);
+}
+
+static void BgraToY8_C(const pxcBYTE *src, pxcBYTE *dst, int x, int width) {
+    for (; x < width; x++)
+        dst[x] = (pxcBYTE)BgrToY(src[x * 4], src[x * 4 + 1], src[x * 4 + 2]);
+}
+
+static void BgraToBgr_C(const pxcBYTE *src, pxcBYTE *dst, int x, int width) {
+    for (; x < width; x++) {
+        dst[x * 3] = src[x * 4];
+        dst[x * 3 + 1] = src[x * 4 + 1];
+        dst[x * 3 + 2] = src[x * 4 + 2];
+    }
+}
+
+static void BgrToBgra_C(const pxcBYTE *src, pxcBYTE *dst, int x, int width) {
+    for (; x < width; x++) {
+        dst[x * 4] = src[x * 3];
+        dst[x * 4 + 1] = src[x * 3 + 1];
+        dst[x * 4 + 2] = src[x * 3 + 2];
+        dst[x * 4 + 3] = 255;
+    }
+}
+
+static void Yuy2ToY8_C(const pxcBYTE *src, pxcBYTE *dst, int x, int width) {
+    for (; x < width; x++) dst[x] = src[x * 2];
+}
+
+/* The chroma kernels start at an even x and write the chroma of a last odd pixel. */
+static void BgraToYuy2_C(const pxcBYTE *src, pxcBYTE *dst, int x, int width) {
+    for (; x < width; x += 2) {
+        const pxcBYTE *p0 = src + x * 4, *p1 = (x + 1 < width) ? p0 + 4 : p0;
+        int b = (p0[0] + p1[0] + 1) >> 1, g = (p0[1] + p1[1] + 1) >> 1, r = (p0[2] + p1[2] + 1) >> 1;
+        dst[x * 2] = (pxcBYTE)BgrToY(p0[0], p0[1], p0[2]);
+        dst[x * 2 + 1] = (pxcBYTE)BgrToU(b, g, r);
+        dst[x * 2 + 2] = (pxcBYTE)BgrToY(p1[0], p1[1], p1[2]);
+        dst[x * 2 + 3] = (pxcBYTE)BgrToV(b, g, r);
+    }
+}
+
+static void BgraToNv12Chroma_C(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int x, int width) {
+    for (; x < width; x += 2) {
+        int x1 = (x + 1 < width) ? x + 1 : x;
+        int b = (src0[x * 4] + src0[x1 * 4] + src1[x * 4] + src1[x1 * 4] + 2) >> 2;
+        int g = (src0[x * 4 + 1] + src0[x1 * 4 + 1] + src1[x * 4 + 1] + src1[x1 * 4 + 1] + 2) >> 2;
+        int r = (src0[x * 4 + 2] + src0[x1 * 4 + 2] + src1[x * 4 + 2] + src1[x1 * 4 + 2] + 2) >> 2;
+        uv[x] = (pxcBYTE)BgrToU(b, g, r);
+        uv[x + 1] = (pxcBYTE)BgrToV(b, g, r);
+    }
+}
+
+static void Yuy2ToNv12Chroma_C(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int x, int width) {
+    for (; x < width; x += 2) {
+        uv[x] = (pxcBYTE)((src0[x * 2 + 1] + src1[x * 2 + 1] + 1) >> 1);
+        uv[x + 1] = (pxcBYTE)((src0[x * 2 + 3] + src1[x * 2 + 3] + 1) >> 1);
+    }
+}
+
+/* Interleave NV12 luma and chroma into YUY2; a NULL uv is neutral chroma, for Y8. */
+static void Nv12ToYuy2_C(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int x, int width) {
+    for (; x < width; x += 2) {
+        dst[x * 2] = y[x];
+        dst[x * 2 + 1] = uv ? uv[x] : 128;
+        dst[x * 2 + 2] = y[(x + 1 < width) ? x + 1 : x];
+        dst[x * 2 + 3] = uv ? uv[x + 1] : 128;
+    }
+}
+
+static inline pxcU16 DepthToU16(float v) {
+    if (!(v > 0)) return 0;
+    if (v >= 65535.0f) return 65535;
+    return (pxcU16)lrintf(v);
+}
+
+static void U16ToU16_C(const pxcU16 *src, pxcU16 *dst, int x, int count, float scale) {
+    for (; x < count; x++) dst[x] = DepthToU16(src[x] * scale);
+}
+
+static void U16ToF32_C(const pxcU16 *src, float *dst, int x, int count, float scale) {
+    for (; x < count; x++) dst[x] = src[x] * scale;
+}
+
+static void F32ToU16_C(const float *src, pxcU16 *dst, int x, int count, float scale) {
+    for (; x < count; x++) dst[x] = DepthToU16(src[x] * scale);
+}
+
+static inline pxcBYTE StretchToY8(int v, int low, float scale) {
+    long y = lrintf((float)(v - low) * scale);
+    return (pxcBYTE)(y < 0 ? 0 : (y > 255 ? 255 : y));
+}
+
+static void Y16ToY8_C(const pxcU16 *src, pxcBYTE *dst, int x, int count, int low, float scale) {
+    for (; x < count; x++) dst[x] = StretchToY8(src[x], low, scale);
+}
+
+static void Yuy2ToBgraRow_C(const pxcBYTE *src, pxcBYTE *dst, int width) { Yuy2ToBgra_C(src, dst, 0, width); }
+static void Nv12ToBgraRow_C(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int width) { Nv12ToBgra_C(y, uv, dst, 0, width); }
+static void BgraToY8Row_C(const pxcBYTE *src, pxcBYTE *dst, int width) { BgraToY8_C(src, dst, 0, width); }
+static void BgraToBgrRow_C(const pxcBYTE *src, pxcBYTE *dst, int width) { BgraToBgr_C(src, dst, 0, width); }
+static void BgrToBgraRow_C(const pxcBYTE *src, pxcBYTE *dst, int width) { BgrToBgra_C(src, dst, 0, width); }
+static void Yuy2ToY8Row_C(const pxcBYTE *src, pxcBYTE *dst, int width) { Yuy2ToY8_C(src, dst, 0, width); }
+static void BgraToYuy2Row_C(const pxcBYTE *src, pxcBYTE *dst, int width) { BgraToYuy2_C(src, dst, 0, width); }
+static void BgraToNv12ChromaRow_C(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width) { BgraToNv12Chroma_C(src0, src1, uv, 0, width); }
+static void Yuy2ToNv12ChromaRow_C(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width) { Yuy2ToNv12Chroma_C(src0, src1, uv, 0, width); }
+static void Nv12ToYuy2Row_C(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int width) { Nv12ToYuy2_C(y, uv, dst, 0, width); }
+static void U16ToU16Row_C(const pxcU16 *src, pxcU16 *dst, int count, float scale) { U16ToU16_C(src, dst, 0, count, scale); }
+static void U16ToF32Row_C(const pxcU16 *src, float *dst, int count, float scale) { U16ToF32_C(src, dst, 0, count, scale); }
+static void F32ToU16Row_C(const float *src, pxcU16 *dst, int count, float scale) { F32ToU16_C(src, dst, 0, count, scale); }
+static void Y16ToY8Row_C(const pxcU16 *src, pxcBYTE *dst, int count, int low, float scale) { Y16ToY8_C(src, dst, 0, count, low, scale); }
+
+#ifdef PXC_SIMD_X86
+
+///////////////////////////////////////////////////////////////////////////////////////
+/* SSE4.1 kernels, 4 pixels per iteration */
+
+static const pxcBYTE g_bgraInterleave[16] = { 0,4,8,12, 1,5,9,13, 2,6,10,14, 3,7,11,15 };
+
+static inline PXC_TARGET_SSE41 __m128i YuvToBgra_SSE41(__m128i y, __m128i u, __m128i v) {
+    __m128i c = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(y, _mm_set1_epi32(16)), _mm_set1_epi32(298)), _mm_set1_epi32(128));
+    __m128i d = _mm_sub_epi32(u, _mm_set1_epi32(128));
+    __m128i e = _mm_sub_epi32(v, _mm_set1_epi32(128));
+    __m128i b = _mm_srai_epi32(_mm_add_epi32(c, _mm_mullo_epi32(d, _mm_set1_epi32(516))), 8);
+    __m128i g = _mm_srai_epi32(_mm_sub_epi32(c, _mm_add_epi32(_mm_mullo_epi32(d, _mm_set1_epi32(100)), _mm_mullo_epi32(e, _mm_set1_epi32(208)))), 8);
+    __m128i r = _mm_srai_epi32(_mm_add_epi32(c, _mm_mullo_epi32(e, _mm_set1_epi32(409))), 8);
+    __m128i bgra = _mm_packus_epi16(_mm_packs_epi32(b, g), _mm_packs_epi32(r, _mm_set1_epi32(255)));
+    return _mm_shuffle_epi8(bgra, _mm_loadu_si128((const __m128i*)g_bgraInterleave));
+}
+
+static inline PXC_TARGET_SSE41 __m128i BgraToY_SSE41(__m128i p) {
+    __m128i mask = _mm_set1_epi32(0xFF);
+    __m128i b = _mm_and_si128(p, mask);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), mask);
+    __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask);
+    __m128i y = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(r, _mm_set1_epi32(66)), _mm_mullo_epi32(g, _mm_set1_epi32(129))), _mm_mullo_epi32(b, _mm_set1_epi32(25)));
+    return _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(y, _mm_set1_epi32(128)), 8), _mm_set1_epi32(16));
+}
+
+static PXC_TARGET_SSE41 void Yuy2ToBgraRow_SSE41(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m128i my = _mm_setr_epi8(0,-1,-1,-1, 2,-1,-1,-1, 4,-1,-1,-1, 6,-1,-1,-1);
+    const __m128i mu = _mm_setr_epi8(1,-1,-1,-1, 1,-1,-1,-1, 5,-1,-1,-1, 5,-1,-1,-1);
+    const __m128i mv = _mm_setr_epi8(3,-1,-1,-1, 3,-1,-1,-1, 7,-1,-1,-1, 7,-1,-1,-1);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i s = _mm_loadl_epi64((const __m128i*)(src + x * 2));
+        _mm_storeu_si128((__m128i*)(dst + x * 4), YuvToBgra_SSE41(_mm_shuffle_epi8(s, my), _mm_shuffle_epi8(s, mu), _mm_shuffle_epi8(s, mv)));
+    }
+    Yuy2ToBgra_C(src, dst, x, width);
+}
+
+static PXC_TARGET_SSE41 void Nv12ToBgraRow_SSE41(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int width) {
+    const __m128i mu = _mm_setr_epi8(0,-1,-1,-1, 0,-1,-1,-1, 2,-1,-1,-1, 2,-1,-1,-1);
+    const __m128i mv = _mm_setr_epi8(1,-1,-1,-1, 1,-1,-1,-1, 3,-1,-1,-1, 3,-1,-1,-1);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i luma = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(Load32(y + x)));
+        __m128i chroma = _mm_cvtsi32_si128(Load32(uv + x));
+        _mm_storeu_si128((__m128i*)(dst + x * 4), YuvToBgra_SSE41(luma, _mm_shuffle_epi8(chroma, mu), _mm_shuffle_epi8(chroma, mv)));
+    }
+    Nv12ToBgra_C(y, uv, dst, x, width);
+}
+
+static PXC_TARGET_SSE41 void BgraToY8Row_SSE41(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i y = BgraToY_SSE41(_mm_loadu_si128((const __m128i*)(src + x * 4)));
+        y = _mm_packus_epi16(_mm_packs_epi32(y, y), y);
+        Store32(dst + x, _mm_cvtsi128_si32(y));
+    }
+    BgraToY8_C(src, dst, x, width);
+}
+
+static PXC_TARGET_SSE41 void BgraToBgrRow_SSE41(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m128i mask = _mm_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i bgr = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + x * 4)), mask);
+        _mm_storel_epi64((__m128i*)(dst + x * 3), bgr);
+        Store32(dst + x * 3 + 8, _mm_cvtsi128_si32(_mm_srli_si128(bgr, 8)));
+    }
+    BgraToBgr_C(src, dst, x, width);
+}
+
+static PXC_TARGET_SSE41 void BgrToBgraRow_SSE41(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m128i mask = _mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    int x = 0;
+    /* each iteration loads 16 bytes but consumes 12; stop while 16 bytes remain */
+    for (; x + 6 <= width; x += 4) {
+        __m128i bgra = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + x * 3)), mask);
+        _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_or_si128(bgra, alpha));
+    }
+    BgrToBgra_C(src, dst, x, width);
+}
+
+static PXC_TARGET_SSE41 void Yuy2ToY8Row_SSE41(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m128i mask = _mm_set1_epi16(0xFF);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i luma = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + x * 2)), mask);
+        _mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(luma, luma));
+    }
+    Yuy2ToY8_C(src, dst, x, width);
+}
+
+/* U and V of the pixels in dwords 0 and 2, interleaved as U0 V0 U2 V2 like the YUY2 and NV12 chroma. */
+static inline PXC_TARGET_SSE41 __m128i BgraToUv_SSE41(__m128i p) {
+    __m128i mask = _mm_set1_epi32(0xFF);
+    __m128i b = _mm_and_si128(p, mask);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), mask);
+    __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask);
+    __m128i u = _mm_sub_epi32(_mm_mullo_epi32(b, _mm_set1_epi32(112)), _mm_add_epi32(_mm_mullo_epi32(r, _mm_set1_epi32(38)), _mm_mullo_epi32(g, _mm_set1_epi32(74))));
+    __m128i v = _mm_sub_epi32(_mm_mullo_epi32(r, _mm_set1_epi32(112)), _mm_add_epi32(_mm_mullo_epi32(g, _mm_set1_epi32(94)), _mm_mullo_epi32(b, _mm_set1_epi32(18))));
+    u = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(u, _mm_set1_epi32(128)), 8), _mm_set1_epi32(128));
+    v = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(v, _mm_set1_epi32(128)), 8), _mm_set1_epi32(128));
+    return _mm_blend_epi16(u, _mm_slli_epi64(v, 32), 0xCC);
+}
+
+/* The rounded average of the 2x2 blocks of two rows of 4 BGRA pixels, in dwords 0 and 2. */
+static inline PXC_TARGET_SSE41 __m128i Average2x2_SSE41(__m128i p0, __m128i p1) {
+    __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(p0, zero), _mm_unpacklo_epi8(p1, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(p0, zero), _mm_unpackhi_epi8(p1, zero));
+    lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, _mm_srli_si128(lo, 8)), two), 2);
+    hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, _mm_srli_si128(hi, 8)), two), 2);
+    return _mm_packus_epi16(lo, hi);
+}
+
+static PXC_TARGET_SSE41 void BgraToYuy2Row_SSE41(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src + x * 4));
+        __m128i uv = BgraToUv_SSE41(_mm_avg_epu8(p, _mm_srli_si128(p, 4)));
+        __m128i yuyv = _mm_or_si128(BgraToY_SSE41(p), _mm_slli_epi32(uv, 8));
+        _mm_storel_epi64((__m128i*)(dst + x * 2), _mm_packus_epi32(yuyv, yuyv));
+    }
+    BgraToYuy2_C(src, dst, x, width);
+}
+
+static PXC_TARGET_SSE41 void BgraToNv12ChromaRow_SSE41(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i c = BgraToUv_SSE41(Average2x2_SSE41(_mm_loadu_si128((const __m128i*)(src0 + x * 4)), _mm_loadu_si128((const __m128i*)(src1 + x * 4))));
+        c = _mm_packus_epi32(c, c);
+        Store32(uv + x, _mm_cvtsi128_si32(_mm_packus_epi16(c, c)));
+    }
+    BgraToNv12Chroma_C(src0, src1, uv, x, width);
+}
+
+/* avg_epu8 rounds like the scalar (a + b + 1) >> 1 */
+static PXC_TARGET_SSE41 void Yuy2ToNv12ChromaRow_SSE41(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i c = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(src0 + x * 2)), _mm_loadu_si128((const __m128i*)(src1 + x * 2)));
+        c = _mm_srli_epi16(c, 8);
+        _mm_storel_epi64((__m128i*)(uv + x), _mm_packus_epi16(c, c));
+    }
+    Yuy2ToNv12Chroma_C(src0, src1, uv, x, width);
+}
+
+static PXC_TARGET_SSE41 void Nv12ToYuy2Row_SSE41(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int width) {
+    __m128i c = _mm_set1_epi8((char)128);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i luma = _mm_loadu_si128((const __m128i*)(y + x));
+        if (uv) c = _mm_loadu_si128((const __m128i*)(uv + x));
+        _mm_storeu_si128((__m128i*)(dst + x * 2), _mm_unpacklo_epi8(luma, c));
+        _mm_storeu_si128((__m128i*)(dst + x * 2 + 16), _mm_unpackhi_epi8(luma, c));
+    }
+    Nv12ToYuy2_C(y, uv, dst, x, width);
+}
+
+/* min(65535, v) keeps NaN, which cvtps_epi32 turns into INT_MIN and packus into zero. */
+static inline PXC_TARGET_SSE41 __m128i DepthToI32_SSE41(__m128 v) {
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_set1_ps(65535.0f), v));
+}
+
+static PXC_TARGET_SSE41 void U16ToU16Row_SSE41(const pxcU16 *src, pxcU16 *dst, int count, float scale) {
+    const __m128 s = _mm_set1_ps(scale);
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + x));
+        __m128i lo = DepthToI32_SSE41(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(v)), s));
+        __m128i hi = DepthToI32_SSE41(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8))), s));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi32(lo, hi));
+    }
+    U16ToU16_C(src, dst, x, count, scale);
+}
+
+static PXC_TARGET_SSE41 void U16ToF32Row_SSE41(const pxcU16 *src, float *dst, int count, float scale) {
+    const __m128 s = _mm_set1_ps(scale);
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + x));
+        _mm_storeu_ps(dst + x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(v)), s));
+        _mm_storeu_ps(dst + x + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8))), s));
+    }
+    U16ToF32_C(src, dst, x, count, scale);
+}
+
+static PXC_TARGET_SSE41 void F32ToU16Row_SSE41(const float *src, pxcU16 *dst, int count, float scale) {
+    const __m128 s = _mm_set1_ps(scale);
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m128i lo = DepthToI32_SSE41(_mm_mul_ps(_mm_loadu_ps(src + x), s));
+        __m128i hi = DepthToI32_SSE41(_mm_mul_ps(_mm_loadu_ps(src + x + 4), s));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi32(lo, hi));
+    }
+    F32ToU16_C(src, dst, x, count, scale);
+}
+
+static inline PXC_TARGET_SSE41 __m128i StretchToI32_SSE41(__m128i v, __m128i low, __m128 scale) {
+    return _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_cvtepu16_epi32(v), low)), scale));
+}
+
+/* The signed and unsigned saturating packs clamp to [0,255]. */
+static PXC_TARGET_SSE41 void Y16ToY8Row_SSE41(const pxcU16 *src, pxcBYTE *dst, int count, int low, float scale) {
+    const __m128i l = _mm_set1_epi32(low);
+    const __m128 s = _mm_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(src + x)), v1 = _mm_loadu_si128((const __m128i*)(src + x + 8));
+        __m128i a = _mm_packs_epi32(StretchToI32_SSE41(v0, l, s), StretchToI32_SSE41(_mm_srli_si128(v0, 8), l, s));
+        __m128i b = _mm_packs_epi32(StretchToI32_SSE41(v1, l, s), StretchToI32_SSE41(_mm_srli_si128(v1, 8), l, s));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(a, b));
+    }
+    Y16ToY8_C(src, dst, x, count, low, scale);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+/* AVX2 kernels, 8 pixels per iteration. Pack and shuffle work within 128-bit lanes,
+   so the low lane holds pixels 0-3 and the high lane pixels 4-7. */
+
+static const pxcBYTE g_yuy2Masks256[3][32] = {
+    { 0,0x80,0x80,0x80, 2,0x80,0x80,0x80, 4,0x80,0x80,0x80, 6,0x80,0x80,0x80,  8,0x80,0x80,0x80, 10,0x80,0x80,0x80, 12,0x80,0x80,0x80, 14,0x80,0x80,0x80 },
+    { 1,0x80,0x80,0x80, 1,0x80,0x80,0x80, 5,0x80,0x80,0x80, 5,0x80,0x80,0x80,  9,0x80,0x80,0x80,  9,0x80,0x80,0x80, 13,0x80,0x80,0x80, 13,0x80,0x80,0x80 },
+    { 3,0x80,0x80,0x80, 3,0x80,0x80,0x80, 7,0x80,0x80,0x80, 7,0x80,0x80,0x80, 11,0x80,0x80,0x80, 11,0x80,0x80,0x80, 15,0x80,0x80,0x80, 15,0x80,0x80,0x80 },
+};
+
+static const pxcBYTE g_nv12Masks256[2][32] = {
+    { 0,0x80,0x80,0x80, 0,0x80,0x80,0x80, 2,0x80,0x80,0x80, 2,0x80,0x80,0x80,  4,0x80,0x80,0x80, 4,0x80,0x80,0x80, 6,0x80,0x80,0x80, 6,0x80,0x80,0x80 },
+    { 1,0x80,0x80,0x80, 1,0x80,0x80,0x80, 3,0x80,0x80,0x80, 3,0x80,0x80,0x80,  5,0x80,0x80,0x80, 5,0x80,0x80,0x80, 7,0x80,0x80,0x80, 7,0x80,0x80,0x80 },
+};
+
+static inline PXC_TARGET_AVX2 __m256i YuvToBgra_AVX2(__m256i y, __m256i u, __m256i v) {
+    __m256i c = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(y, _mm256_set1_epi32(16)), _mm256_set1_epi32(298)), _mm256_set1_epi32(128));
+    __m256i d = _mm256_sub_epi32(u, _mm256_set1_epi32(128));
+    __m256i e = _mm256_sub_epi32(v, _mm256_set1_epi32(128));
+    __m256i b = _mm256_srai_epi32(_mm256_add_epi32(c, _mm256_mullo_epi32(d, _mm256_set1_epi32(516))), 8);
+    __m256i g = _mm256_srai_epi32(_mm256_sub_epi32(c, _mm256_add_epi32(_mm256_mullo_epi32(d, _mm256_set1_epi32(100)), _mm256_mullo_epi32(e, _mm256_set1_epi32(208)))), 8);
+    __m256i r = _mm256_srai_epi32(_mm256_add_epi32(c, _mm256_mullo_epi32(e, _mm256_set1_epi32(409))), 8);
+    __m256i bgra = _mm256_packus_epi16(_mm256_packs_epi32(b, g), _mm256_packs_epi32(r, _mm256_set1_epi32(255)));
+    return _mm256_shuffle_epi8(bgra, _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)g_bgraInterleave)));
+}
+
+static PXC_TARGET_AVX2 void Yuy2ToBgraRow_AVX2(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m256i my = _mm256_loadu_si256((const __m256i*)g_yuy2Masks256[0]);
+    const __m256i mu = _mm256_loadu_si256((const __m256i*)g_yuy2Masks256[1]);
+    const __m256i mv = _mm256_loadu_si256((const __m256i*)g_yuy2Masks256[2]);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i s = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(src + x * 2)));
+        _mm256_storeu_si256((__m256i*)(dst + x * 4), YuvToBgra_AVX2(_mm256_shuffle_epi8(s, my), _mm256_shuffle_epi8(s, mu), _mm256_shuffle_epi8(s, mv)));
+    }
+    Yuy2ToBgra_C(src, dst, x, width);
+}
+
+static PXC_TARGET_AVX2 void Nv12ToBgraRow_AVX2(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int width) {
+    const __m256i mu = _mm256_loadu_si256((const __m256i*)g_nv12Masks256[0]);
+    const __m256i mv = _mm256_loadu_si256((const __m256i*)g_nv12Masks256[1]);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i luma = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(y + x)));
+        __m256i chroma = _mm256_broadcastsi128_si256(_mm_loadl_epi64((const __m128i*)(uv + x)));
+        _mm256_storeu_si256((__m256i*)(dst + x * 4), YuvToBgra_AVX2(luma, _mm256_shuffle_epi8(chroma, mu), _mm256_shuffle_epi8(chroma, mv)));
+    }
+    Nv12ToBgra_C(y, uv, dst, x, width);
+}
+
+static PXC_TARGET_AVX2 void BgraToY8Row_AVX2(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+        __m256i b = _mm256_and_si256(p, mask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask);
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask);
+        __m256i y = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(66)), _mm256_mullo_epi32(g, _mm256_set1_epi32(129))), _mm256_mullo_epi32(b, _mm256_set1_epi32(25)));
+        y = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(y, _mm256_set1_epi32(128)), 8), _mm256_set1_epi32(16));
+        y = _mm256_packus_epi16(_mm256_packs_epi32(y, y), y);
+        __m128i packed = _mm_unpacklo_epi32(_mm256_castsi256_si128(y), _mm256_extracti128_si256(y, 1));
+        _mm_storel_epi64((__m128i*)(dst + x), packed);
+    }
+    BgraToY8_C(src, dst, x, width);
+}
+
+static inline PXC_TARGET_AVX2 __m256i BgraToUv_AVX2(__m256i p) {
+    __m256i mask = _mm256_set1_epi32(0xFF);
+    __m256i b = _mm256_and_si256(p, mask);
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask);
+    __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask);
+    __m256i u = _mm256_sub_epi32(_mm256_mullo_epi32(b, _mm256_set1_epi32(112)), _mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(38)), _mm256_mullo_epi32(g, _mm256_set1_epi32(74))));
+    __m256i v = _mm256_sub_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(112)), _mm256_add_epi32(_mm256_mullo_epi32(g, _mm256_set1_epi32(94)), _mm256_mullo_epi32(b, _mm256_set1_epi32(18))));
+    u = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(u, _mm256_set1_epi32(128)), 8), _mm256_set1_epi32(128));
+    v = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(128)), 8), _mm256_set1_epi32(128));
+    return _mm256_blend_epi16(u, _mm256_slli_epi64(v, 32), 0xCC);
+}
+
+static inline PXC_TARGET_AVX2 __m256i BgraToY_AVX2(__m256i p) {
+    __m256i mask = _mm256_set1_epi32(0xFF);
+    __m256i b = _mm256_and_si256(p, mask);
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask);
+    __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask);
+    __m256i y = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(66)), _mm256_mullo_epi32(g, _mm256_set1_epi32(129))), _mm256_mullo_epi32(b, _mm256_set1_epi32(25)));
+    return _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(y, _mm256_set1_epi32(128)), 8), _mm256_set1_epi32(16));
+}
+
+static inline PXC_TARGET_AVX2 __m256i Average2x2_AVX2(__m256i p0, __m256i p1) {
+    __m256i zero = _mm256_setzero_si256(), two = _mm256_set1_epi16(2);
+    __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(p0, zero), _mm256_unpacklo_epi8(p1, zero));
+    __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(p0, zero), _mm256_unpackhi_epi8(p1, zero));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo, _mm256_srli_si256(lo, 8)), two), 2);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi, _mm256_srli_si256(hi, 8)), two), 2);
+    return _mm256_packus_epi16(lo, hi);
+}
+
+static PXC_TARGET_AVX2 void BgraToYuy2Row_AVX2(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+        __m256i uv = BgraToUv_AVX2(_mm256_avg_epu8(p, _mm256_srli_si256(p, 4)));
+        __m256i yuyv = _mm256_or_si256(BgraToY_AVX2(p), _mm256_slli_epi32(uv, 8));
+        yuyv = _mm256_permute4x64_epi64(_mm256_packus_epi32(yuyv, yuyv), 0x08);
+        _mm_storeu_si128((__m128i*)(dst + x * 2), _mm256_castsi256_si128(yuyv));
+    }
+    BgraToYuy2_C(src, dst, x, width);
+}
+
+static PXC_TARGET_AVX2 void BgraToNv12ChromaRow_AVX2(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i c = BgraToUv_AVX2(Average2x2_AVX2(_mm256_loadu_si256((const __m256i*)(src0 + x * 4)), _mm256_loadu_si256((const __m256i*)(src1 + x * 4))));
+        c = _mm256_packus_epi32(c, c);
+        c = _mm256_packus_epi16(c, c);
+        Store32(uv + x, _mm_cvtsi128_si32(_mm256_castsi256_si128(c)));
+        Store32(uv + x + 4, _mm_cvtsi128_si32(_mm256_extracti128_si256(c, 1)));
+    }
+    BgraToNv12Chroma_C(src0, src1, uv, x, width);
+}
+
+static PXC_TARGET_AVX2 void Yuy2ToNv12ChromaRow_AVX2(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i c = _mm256_avg_epu8(_mm256_loadu_si256((const __m256i*)(src0 + x * 2)), _mm256_loadu_si256((const __m256i*)(src1 + x * 2)));
+        c = _mm256_srli_epi16(c, 8);
+        c = _mm256_permute4x64_epi64(_mm256_packus_epi16(c, c), 0x08);
+        _mm_storeu_si128((__m128i*)(uv + x), _mm256_castsi256_si128(c));
+    }
+    Yuy2ToNv12Chroma_C(src0, src1, uv, x, width);
+}
+
+static PXC_TARGET_AVX2 void Nv12ToYuy2Row_AVX2(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int width) {
+    __m256i c = _mm256_set1_epi8((char)128);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i luma = _mm256_loadu_si256((const __m256i*)(y + x));
+        if (uv) c = _mm256_loadu_si256((const __m256i*)(uv + x));
+        /* the low lane interleaves pixels 0-7 and 8-15, the high lane pixels 16-23 and 24-31 */
+        __m256i lo = _mm256_unpacklo_epi8(luma, c), hi = _mm256_unpackhi_epi8(luma, c);
+        _mm256_storeu_si256((__m256i*)(dst + x * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + x * 2 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    Nv12ToYuy2_C(y, uv, dst, x, width);
+}
+
+static inline PXC_TARGET_AVX2 __m256i DepthToI32_AVX2(__m256 v) {
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_set1_ps(65535.0f), v));
+}
+
+/* packus_epi32 interleaves the 128-bit lanes; permute4x64 restores the pixel order. */
+static inline PXC_TARGET_AVX2 __m256i PackDepth_AVX2(__m256i lo, __m256i hi) {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+}
+
+static PXC_TARGET_AVX2 void U16ToU16Row_AVX2(const pxcU16 *src, pxcU16 *dst, int count, float scale) {
+    const __m256 s = _mm256_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m256i lo = DepthToI32_AVX2(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + x)))), s));
+        __m256i hi = DepthToI32_AVX2(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + x + 8)))), s));
+        _mm256_storeu_si256((__m256i*)(dst + x), PackDepth_AVX2(lo, hi));
+    }
+    U16ToU16_C(src, dst, x, count, scale);
+}
+
+static PXC_TARGET_AVX2 void U16ToF32Row_AVX2(const pxcU16 *src, float *dst, int count, float scale) {
+    const __m256 s = _mm256_set1_ps(scale);
+    int x = 0;
+    for (; x + 8 <= count; x += 8)
+        _mm256_storeu_ps(dst + x, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + x)))), s));
+    U16ToF32_C(src, dst, x, count, scale);
+}
+
+static PXC_TARGET_AVX2 void F32ToU16Row_AVX2(const float *src, pxcU16 *dst, int count, float scale) {
+    const __m256 s = _mm256_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m256i lo = DepthToI32_AVX2(_mm256_mul_ps(_mm256_loadu_ps(src + x), s));
+        __m256i hi = DepthToI32_AVX2(_mm256_mul_ps(_mm256_loadu_ps(src + x + 8), s));
+        _mm256_storeu_si256((__m256i*)(dst + x), PackDepth_AVX2(lo, hi));
+    }
+    F32ToU16_C(src, dst, x, count, scale);
+}
+
+static inline PXC_TARGET_AVX2 __m256i StretchToI32_AVX2(const pxcU16 *src, __m256i low, __m256 scale) {
+    __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src));
+    return _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(v, low)), scale));
+}
+
+static PXC_TARGET_AVX2 void Y16ToY8Row_AVX2(const pxcU16 *src, pxcBYTE *dst, int count, int low, float scale) {
+    const __m256i l = _mm256_set1_epi32(low);
+    const __m256 s = _mm256_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(StretchToI32_AVX2(src + x, l, s), StretchToI32_AVX2(src + x + 8, l, s)), 0xD8);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+    }
+    Y16ToY8_C(src, dst, x, count, low, scale);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+/* AVX-512 kernels, 16 pixels per iteration, one group of 4 pixels per 128-bit lane */
+
+static const pxcBYTE g_yuy2Masks512[3][64] = {
+    { 0,0x80,0x80,0x80, 2,0x80,0x80,0x80, 4,0x80,0x80,0x80, 6,0x80,0x80,0x80,  8,0x80,0x80,0x80, 10,0x80,0x80,0x80, 12,0x80,0x80,0x80, 14,0x80,0x80,0x80,
+      0,0x80,0x80,0x80, 2,0x80,0x80,0x80, 4,0x80,0x80,0x80, 6,0x80,0x80,0x80,  8,0x80,0x80,0x80, 10,0x80,0x80,0x80, 12,0x80,0x80,0x80, 14,0x80,0x80,0x80 },
+    { 1,0x80,0x80,0x80, 1,0x80,0x80,0x80, 5,0x80,0x80,0x80, 5,0x80,0x80,0x80,  9,0x80,0x80,0x80,  9,0x80,0x80,0x80, 13,0x80,0x80,0x80, 13,0x80,0x80,0x80,
+      1,0x80,0x80,0x80, 1,0x80,0x80,0x80, 5,0x80,0x80,0x80, 5,0x80,0x80,0x80,  9,0x80,0x80,0x80,  9,0x80,0x80,0x80, 13,0x80,0x80,0x80, 13,0x80,0x80,0x80 },
+    { 3,0x80,0x80,0x80, 3,0x80,0x80,0x80, 7,0x80,0x80,0x80, 7,0x80,0x80,0x80, 11,0x80,0x80,0x80, 11,0x80,0x80,0x80, 15,0x80,0x80,0x80, 15,0x80,0x80,0x80,
+      3,0x80,0x80,0x80, 3,0x80,0x80,0x80, 7,0x80,0x80,0x80, 7,0x80,0x80,0x80, 11,0x80,0x80,0x80, 11,0x80,0x80,0x80, 15,0x80,0x80,0x80, 15,0x80,0x80,0x80 },
+};
+
+static const pxcBYTE g_nv12Masks512[2][64] = {
+    { 0,0x80,0x80,0x80, 0,0x80,0x80,0x80, 2,0x80,0x80,0x80, 2,0x80,0x80,0x80,  4,0x80,0x80,0x80, 4,0x80,0x80,0x80, 6,0x80,0x80,0x80, 6,0x80,0x80,0x80,
+      8,0x80,0x80,0x80, 8,0x80,0x80,0x80, 10,0x80,0x80,0x80, 10,0x80,0x80,0x80, 12,0x80,0x80,0x80, 12,0x80,0x80,0x80, 14,0x80,0x80,0x80, 14,0x80,0x80,0x80 },
+    { 1,0x80,0x80,0x80, 1,0x80,0x80,0x80, 3,0x80,0x80,0x80, 3,0x80,0x80,0x80,  5,0x80,0x80,0x80, 5,0x80,0x80,0x80, 7,0x80,0x80,0x80, 7,0x80,0x80,0x80,
+      9,0x80,0x80,0x80, 9,0x80,0x80,0x80, 11,0x80,0x80,0x80, 11,0x80,0x80,0x80, 13,0x80,0x80,0x80, 13,0x80,0x80,0x80, 15,0x80,0x80,0x80, 15,0x80,0x80,0x80 },
+};
+
+static inline PXC_TARGET_AVX512 __m512i YuvToBgra_AVX512(__m512i y, __m512i u, __m512i v) {
+    __m512i c = _mm512_add_epi32(_mm512_mullo_epi32(_mm512_sub_epi32(y, _mm512_set1_epi32(16)), _mm512_set1_epi32(298)), _mm512_set1_epi32(128));
+    __m512i d = _mm512_sub_epi32(u, _mm512_set1_epi32(128));
+    __m512i e = _mm512_sub_epi32(v, _mm512_set1_epi32(128));
+    __m512i b = _mm512_srai_epi32(_mm512_add_epi32(c, _mm512_mullo_epi32(d, _mm512_set1_epi32(516))), 8);
+    __m512i g = _mm512_srai_epi32(_mm512_sub_epi32(c, _mm512_add_epi32(_mm512_mullo_epi32(d, _mm512_set1_epi32(100)), _mm512_mullo_epi32(e, _mm512_set1_epi32(208)))), 8);
+    __m512i r = _mm512_srai_epi32(_mm512_add_epi32(c, _mm512_mullo_epi32(e, _mm512_set1_epi32(409))), 8);
+    __m512i bgra = _mm512_packus_epi16(_mm512_packs_epi32(b, g), _mm512_packs_epi32(r, _mm512_set1_epi32(255)));
+    return _mm512_shuffle_epi8(bgra, _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)g_bgraInterleave)));
+}
+
+static PXC_TARGET_AVX512 void Yuy2ToBgraRow_AVX512(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m512i my = _mm512_loadu_si512(g_yuy2Masks512[0]);
+    const __m512i mu = _mm512_loadu_si512(g_yuy2Masks512[1]);
+    const __m512i mv = _mm512_loadu_si512(g_yuy2Masks512[2]);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        /* lanes 0,1 take pixels 0-7 from the low 16 bytes, lanes 2,3 pixels 8-15 from the high 16 bytes */
+        __m512i s = _mm512_castsi256_si512(_mm256_loadu_si256((const __m256i*)(src + x * 2)));
+        s = _mm512_shuffle_i64x2(s, s, 0x50);
+        _mm512_storeu_si512(dst + x * 4, YuvToBgra_AVX512(_mm512_shuffle_epi8(s, my), _mm512_shuffle_epi8(s, mu), _mm512_shuffle_epi8(s, mv)));
+    }
+    Yuy2ToBgra_C(src, dst, x, width);
+}
+
+static PXC_TARGET_AVX512 void Nv12ToBgraRow_AVX512(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int width) {
+    const __m512i mu = _mm512_loadu_si512(g_nv12Masks512[0]);
+    const __m512i mv = _mm512_loadu_si512(g_nv12Masks512[1]);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i luma = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(y + x)));
+        __m512i chroma = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)(uv + x)));
+        _mm512_storeu_si512(dst + x * 4, YuvToBgra_AVX512(luma, _mm512_shuffle_epi8(chroma, mu), _mm512_shuffle_epi8(chroma, mv)));
+    }
+    Nv12ToBgra_C(y, uv, dst, x, width);
+}
+
+static PXC_TARGET_AVX512 void BgraToY8Row_AVX512(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m512i mask = _mm512_set1_epi32(0xFF);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i p = _mm512_loadu_si512(src + x * 4);
+        __m512i b = _mm512_and_si512(p, mask);
+        __m512i g = _mm512_and_si512(_mm512_srli_epi32(p, 8), mask);
+        __m512i r = _mm512_and_si512(_mm512_srli_epi32(p, 16), mask);
+        __m512i y = _mm512_add_epi32(_mm512_add_epi32(_mm512_mullo_epi32(r, _mm512_set1_epi32(66)), _mm512_mullo_epi32(g, _mm512_set1_epi32(129))), _mm512_mullo_epi32(b, _mm512_set1_epi32(25)));
+        y = _mm512_add_epi32(_mm512_srai_epi32(_mm512_add_epi32(y, _mm512_set1_epi32(128)), 8), _mm512_set1_epi32(16));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm512_cvtepi32_epi8(y));
+    }
+    BgraToY8_C(src, dst, x, width);
+}
+
+static inline PXC_TARGET_AVX512 __m512i BgraToUv_AVX512(__m512i p) {
+    __m512i mask = _mm512_set1_epi32(0xFF);
+    __m512i b = _mm512_and_si512(p, mask);
+    __m512i g = _mm512_and_si512(_mm512_srli_epi32(p, 8), mask);
+    __m512i r = _mm512_and_si512(_mm512_srli_epi32(p, 16), mask);
+    __m512i u = _mm512_sub_epi32(_mm512_mullo_epi32(b, _mm512_set1_epi32(112)), _mm512_add_epi32(_mm512_mullo_epi32(r, _mm512_set1_epi32(38)), _mm512_mullo_epi32(g, _mm512_set1_epi32(74))));
+    __m512i v = _mm512_sub_epi32(_mm512_mullo_epi32(r, _mm512_set1_epi32(112)), _mm512_add_epi32(_mm512_mullo_epi32(g, _mm512_set1_epi32(94)), _mm512_mullo_epi32(b, _mm512_set1_epi32(18))));
+    u = _mm512_add_epi32(_mm512_srai_epi32(_mm512_add_epi32(u, _mm512_set1_epi32(128)), 8), _mm512_set1_epi32(128));
+    v = _mm512_add_epi32(_mm512_srai_epi32(_mm512_add_epi32(v, _mm512_set1_epi32(128)), 8), _mm512_set1_epi32(128));
+    return _mm512_mask_blend_epi32(0xAAAA, u, _mm512_slli_epi64(v, 32));
+}
+
+static inline PXC_TARGET_AVX512 __m512i BgraToY_AVX512(__m512i p) {
+    __m512i mask = _mm512_set1_epi32(0xFF);
+    __m512i b = _mm512_and_si512(p, mask);
+    __m512i g = _mm512_and_si512(_mm512_srli_epi32(p, 8), mask);
+    __m512i r = _mm512_and_si512(_mm512_srli_epi32(p, 16), mask);
+    __m512i y = _mm512_add_epi32(_mm512_add_epi32(_mm512_mullo_epi32(r, _mm512_set1_epi32(66)), _mm512_mullo_epi32(g, _mm512_set1_epi32(129))), _mm512_mullo_epi32(b, _mm512_set1_epi32(25)));
+    return _mm512_add_epi32(_mm512_srai_epi32(_mm512_add_epi32(y, _mm512_set1_epi32(128)), 8), _mm512_set1_epi32(16));
+}
+
+static inline PXC_TARGET_AVX512 __m512i Average2x2_AVX512(__m512i p0, __m512i p1) {
+    __m512i zero = _mm512_setzero_si512(), two = _mm512_set1_epi16(2);
+    __m512i lo = _mm512_add_epi16(_mm512_unpacklo_epi8(p0, zero), _mm512_unpacklo_epi8(p1, zero));
+    __m512i hi = _mm512_add_epi16(_mm512_unpackhi_epi8(p0, zero), _mm512_unpackhi_epi8(p1, zero));
+    lo = _mm512_srli_epi16(_mm512_add_epi16(_mm512_add_epi16(lo, _mm512_bsrli_epi128(lo, 8)), two), 2);
+    hi = _mm512_srli_epi16(_mm512_add_epi16(_mm512_add_epi16(hi, _mm512_bsrli_epi128(hi, 8)), two), 2);
+    return _mm512_packus_epi16(lo, hi);
+}
+
+static PXC_TARGET_AVX512 void BgraToYuy2Row_AVX512(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i p = _mm512_loadu_si512(src + x * 4);
+        __m512i uv = BgraToUv_AVX512(_mm512_avg_epu8(p, _mm512_bsrli_epi128(p, 4)));
+        __m512i yuyv = _mm512_or_si512(BgraToY_AVX512(p), _mm512_slli_epi32(uv, 8));
+        _mm256_storeu_si256((__m256i*)(dst + x * 2), _mm512_cvtepi32_epi16(yuyv));
+    }
+    BgraToYuy2_C(src, dst, x, width);
+}
+
+static PXC_TARGET_AVX512 void BgraToNv12ChromaRow_AVX512(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i c = BgraToUv_AVX512(Average2x2_AVX512(_mm512_loadu_si512(src0 + x * 4), _mm512_loadu_si512(src1 + x * 4)));
+        _mm_storeu_si128((__m128i*)(uv + x), _mm512_cvtepi32_epi8(c));
+    }
+    BgraToNv12Chroma_C(src0, src1, uv, x, width);
+}
+
+static PXC_TARGET_AVX512 void Yuy2ToNv12ChromaRow_AVX512(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m512i c = _mm512_avg_epu8(_mm512_loadu_si512(src0 + x * 2), _mm512_loadu_si512(src1 + x * 2));
+        _mm256_storeu_si256((__m256i*)(uv + x), _mm512_cvtepi16_epi8(_mm512_srli_epi16(c, 8)));
+    }
+    Yuy2ToNv12Chroma_C(src0, src1, uv, x, width);
+}
+
+/* max_epi32 clears the negative and NaN lanes before the unsigned saturating narrow. */
+static inline PXC_TARGET_AVX512 __m256i DepthToU16_AVX512(__m512 v) {
+    __m512i i = _mm512_cvtps_epi32(_mm512_min_ps(_mm512_set1_ps(65535.0f), v));
+    return _mm512_cvtusepi32_epi16(_mm512_max_epi32(i, _mm512_setzero_si512()));
+}
+
+static PXC_TARGET_AVX512 void U16ToU16Row_AVX512(const pxcU16 *src, pxcU16 *dst, int count, float scale) {
+    const __m512 s = _mm512_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m512 v = _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(src + x))));
+        _mm256_storeu_si256((__m256i*)(dst + x), DepthToU16_AVX512(_mm512_mul_ps(v, s)));
+    }
+    U16ToU16_C(src, dst, x, count, scale);
+}
+
+static PXC_TARGET_AVX512 void U16ToF32Row_AVX512(const pxcU16 *src, float *dst, int count, float scale) {
+    const __m512 s = _mm512_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= count; x += 16)
+        _mm512_storeu_ps(dst + x, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(src + x)))), s));
+    U16ToF32_C(src, dst, x, count, scale);
+}
+
+static PXC_TARGET_AVX512 void F32ToU16Row_AVX512(const float *src, pxcU16 *dst, int count, float scale) {
+    const __m512 s = _mm512_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= count; x += 16)
+        _mm256_storeu_si256((__m256i*)(dst + x), DepthToU16_AVX512(_mm512_mul_ps(_mm512_loadu_ps(src + x), s)));
+    F32ToU16_C(src, dst, x, count, scale);
+}
+
+static PXC_TARGET_AVX512 void Y16ToY8Row_AVX512(const pxcU16 *src, pxcBYTE *dst, int count, int low, float scale) {
+    const __m512i l = _mm512_set1_epi32(low);
+    const __m512 s = _mm512_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m512i v = _mm512_sub_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(src + x))), l);
+        __m512i y = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_cvtepi32_ps(v), s));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm512_cvtusepi32_epi8(_mm512_max_epi32(y, _mm512_setzero_si512())));
+    }
+    Y16ToY8_C(src, dst, x, count, low, scale);
+}
+
+#endif /* PXC_SIMD_X86 */
+
+///////////////////////////////////////////////////////////////////////////////////////
+/* kernel dispatch */
+
+struct KernelTable {
+    pxcI32  features;
+    void    (*yuy2ToBgra)(const pxcBYTE *src, pxcBYTE *dst, int width);
+    void    (*nv12ToBgra)(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int width);
+    void    (*bgraToY8)(const pxcBYTE *src, pxcBYTE *dst, int width);
+    void    (*bgraToBgr)(const pxcBYTE *src, pxcBYTE *dst, int width);
+    void    (*bgrToBgra)(const pxcBYTE *src, pxcBYTE *dst, int width);
+    void    (*yuy2ToY8)(const pxcBYTE *src, pxcBYTE *dst, int width);
+    void    (*u16ToU16)(const pxcU16 *src, pxcU16 *dst, int count, float scale);
+    void    (*u16ToF32)(const pxcU16 *src, float *dst, int count, float scale);
+    void    (*f32ToU16)(const float *src, pxcU16 *dst, int count, float scale);
+    void    (*y16ToY8)(const pxcU16 *src, pxcBYTE *dst, int count, int low, float scale);
+    void    (*bgraToYuy2)(const pxcBYTE *src, pxcBYTE *dst, int width);
+    void    (*bgraToNv12Chroma)(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width);
+    void    (*yuy2ToNv12Chroma)(const pxcBYTE *src0, const pxcBYTE *src1, pxcBYTE *uv, int width);
+    void    (*nv12ToYuy2)(const pxcBYTE *y, const pxcBYTE *uv, pxcBYTE *dst, int width);
+};
+
+static const KernelTable g_kernelsC = {
+    PXCImageConversion::CPU_FEATURE_NONE,
+    Yuy2ToBgraRow_C, Nv12ToBgraRow_C, BgraToY8Row_C, BgraToBgrRow_C, BgrToBgraRow_C, Yuy2ToY8Row_C,
+    U16ToU16Row_C, U16ToF32Row_C, F32ToU16Row_C, Y16ToY8Row_C,
+    BgraToYuy2Row_C, BgraToNv12ChromaRow_C, Yuy2ToNv12ChromaRow_C, Nv12ToYuy2Row_C,
+};
+
+#ifdef PXC_SIMD_X86
+static const KernelTable g_kernelsSSE41 = {
+    PXCImageConversion::CPU_FEATURE_SSE41,
+    Yuy2ToBgraRow_SSE41, Nv12ToBgraRow_SSE41, BgraToY8Row_SSE41, BgraToBgrRow_SSE41, BgrToBgraRow_SSE41, Yuy2ToY8Row_SSE41,
+    U16ToU16Row_SSE41, U16ToF32Row_SSE41, F32ToU16Row_SSE41, Y16ToY8Row_SSE41,
+    BgraToYuy2Row_SSE41, BgraToNv12ChromaRow_SSE41, Yuy2ToNv12ChromaRow_SSE41, Nv12ToYuy2Row_SSE41,
+};
+
+/* The byte shuffles between BGRA and BGR are memory bound and stay on SSE4.1. */
+static const KernelTable g_kernelsAVX2 = {
+    PXCImageConversion::CPU_FEATURE_SSE41 | PXCImageConversion::CPU_FEATURE_AVX2,
+    Yuy2ToBgraRow_AVX2, Nv12ToBgraRow_AVX2, BgraToY8Row_AVX2, BgraToBgrRow_SSE41, BgrToBgraRow_SSE41, Yuy2ToY8Row_SSE41,
+    U16ToU16Row_AVX2, U16ToF32Row_AVX2, F32ToU16Row_AVX2, Y16ToY8Row_AVX2,
+    BgraToYuy2Row_AVX2, BgraToNv12ChromaRow_AVX2, Yuy2ToNv12ChromaRow_AVX2, Nv12ToYuy2Row_AVX2,
+};
+
+/* The YUY2 interleave is memory bound and stays on AVX2. */
+static const KernelTable g_kernelsAVX512 = {
+    PXCImageConversion::CPU_FEATURE_SSE41 | PXCImageConversion::CPU_FEATURE_AVX2 | PXCImageConversion::CPU_FEATURE_AVX512,
+    Yuy2ToBgraRow_AVX512, Nv12ToBgraRow_AVX512, BgraToY8Row_AVX512, BgraToBgrRow_SSE41, BgrToBgraRow_SSE41, Yuy2ToY8Row_SSE41,
+    U16ToU16Row_AVX512, U16ToF32Row_AVX512, F32ToU16Row_AVX512, Y16ToY8Row_AVX512,
+    BgraToYuy2Row_AVX512, BgraToNv12ChromaRow_AVX512, Yuy2ToNv12ChromaRow_AVX512, Nv12ToYuy2Row_AVX2,
+};
+#endif
+
+static const KernelTable *SelectKernels(pxcI32 features) {
+    features &= PXCSimd_DetectCpuFeatures();
+#ifdef PXC_SIMD_X86
+    const pxcI32 avx512 = PXC_SIMD_SSE41 | PXC_SIMD_AVX2 | PXC_SIMD_AVX512, avx2 = PXC_SIMD_SSE41 | PXC_SIMD_AVX2;
+    if ((features & avx512) == avx512) return &g_kernelsAVX512;
+    if ((features & avx2) == avx2) return &g_kernelsAVX2;
+    if (features & PXC_SIMD_SSE41) return &g_kernelsSSE41;
+#endif
+    return &g_kernelsC;
+}
+
+static std::atomic<const KernelTable*> g_kernels(0);
+
+static const KernelTable *Kernels(void) {
+    const KernelTable *kernels = g_kernels.load(std::memory_order_acquire);
+    if (!kernels) {
+        kernels = SelectKernels(PXCImageConversion::CPU_FEATURE_ALL);
+        g_kernels.store(kernels, std::memory_order_release);
+    }
+    return kernels;
+}
+
+pxcI32 PXCImageConversion::QueryCpuFeatures(void) {
+    return Kernels()->features;
+}
+
+pxcI32 PXCImageConversion::SetCpuFeatures(pxcI32 features) {
+    const KernelTable *kernels = SelectKernels(features);
+    g_kernels.store(kernels, std::memory_order_release);
+    return kernels->features;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+/* conversion drivers */
+
+static inline pxcBYTE *Row(const ImageData *data, int plane, int y) {
+    return data->planes[plane] + (size_t)y * data->pitches[plane];
+}
+
+static bool IsColorFormat(PXCImage::PixelFormat format) {
+    switch (format) {
+    case PXCImage::PIXEL_FORMAT_YUY2:
+    case PXCImage::PIXEL_FORMAT_NV12:
+    case PXCImage::PIXEL_FORMAT_RGB32:
+    case PXCImage::PIXEL_FORMAT_RGB24:
+    case PXCImage::PIXEL_FORMAT_Y8:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool IsDepthFormat(PXCImage::PixelFormat format) {
+    return format == PXCImage::PIXEL_FORMAT_DEPTH_RAW || format == PXCImage::PIXEL_FORMAT_DEPTH || format == PXCImage::PIXEL_FORMAT_DEPTH_F32;
+}
+
+static bool IsIrFormat(PXCImage::PixelFormat format) {
+    return format == PXCImage::PIXEL_FORMAT_Y16 || format == PXCImage::PIXEL_FORMAT_Y8_IR_RELATIVE;
+}
+
+static int PlaneCount(PXCImage::PixelFormat format) {
+    return (format == PXCImage::PIXEL_FORMAT_NV12) ? 2 : 1;
+}
+
+static int BytesPerPixel(PXCImage::PixelFormat format) {
+    switch (format) {
+    case PXCImage::PIXEL_FORMAT_YUY2:   return 2;
+    case PXCImage::PIXEL_FORMAT_RGB32:  return 4;
+    case PXCImage::PIXEL_FORMAT_RGB24:  return 3;
+    case PXCImage::PIXEL_FORMAT_DEPTH:
+    case PXCImage::PIXEL_FORMAT_DEPTH_RAW:
+    case PXCImage::PIXEL_FORMAT_Y16:        return 2;
+    case PXCImage::PIXEL_FORMAT_DEPTH_F32:  return 4;
+    default:                            return 1;
+    }
+}
+
+static void CopyImageData(const ImageData *src, ImageData *dst, int width, int height) {
+    int rowBytes = BytesPerPixel(src->format) * ((src->format == PXCImage::PIXEL_FORMAT_YUY2) ? ((width + 1) & ~1) : width);
+    for (int y = 0; y < height; y++)
+        memcpy(Row(dst, 0, y), Row(src, 0, y), rowBytes);
+    if (src->format == PXCImage::PIXEL_FORMAT_NV12) {
+        for (int y = 0; y < (height + 1) / 2; y++)
+            memcpy(Row(dst, 1, y), Row(src, 1, y), (width + 1) & ~1);
+    }
+}
+
+/* Decode one row of any color format to BGRA. */
+static void DecodeRow(const KernelTable *k, const ImageData *src, int y, int width, pxcBYTE *bgra, const pxcBYTE *grayLut) {
+    const pxcBYTE *row = Row(src, 0, y);
+    switch (src->format) {
+    case PXCImage::PIXEL_FORMAT_YUY2:   k->yuy2ToBgra(row, bgra, width); break;
+    case PXCImage::PIXEL_FORMAT_NV12:   k->nv12ToBgra(row, Row(src, 1, y / 2), bgra, width); break;
+    case PXCImage::PIXEL_FORMAT_RGB32:  memcpy(bgra, row, (size_t)width * 4); break;
+    case PXCImage::PIXEL_FORMAT_RGB24:  k->bgrToBgra(row, bgra, width); break;
+    case PXCImage::PIXEL_FORMAT_Y8:
+        for (int x = 0; x < width; x++) Store32(bgra + x * 4, grayLut[row[x]] * 0x010101 | (pxcI32)0xFF000000);
+        break;
+    default: break;
+    }
+}
+
+/* Encode one BGRA row to any color format but NV12. */
+static void EncodeRow(const KernelTable *k, const pxcBYTE *bgra, ImageData *dst, int y, int width) {
+    pxcBYTE *row = Row(dst, 0, y);
+    switch (dst->format) {
+    case PXCImage::PIXEL_FORMAT_RGB32:  if (row != bgra) memcpy(row, bgra, (size_t)width * 4); break;
+    case PXCImage::PIXEL_FORMAT_RGB24:  k->bgraToBgr(bgra, row, width); break;
+    case PXCImage::PIXEL_FORMAT_Y8:     k->bgraToY8(bgra, row, width); break;
+    case PXCImage::PIXEL_FORMAT_YUY2:   k->bgraToYuy2(bgra, row, width); break;
+    default: break;
+    }
+}
+
+/* Conversions between luma/chroma formats that do not round-trip through RGB. */
+static bool ConvertYuv(const KernelTable *k, const ImageData *src, ImageData *dst, int width, int height) {
+    PXCImage::PixelFormat sf = src->format, df = dst->format;
+    int cw = (width + 1) & ~1;
+    if (df == PXCImage::PIXEL_FORMAT_Y8) {
+        if (sf == PXCImage::PIXEL_FORMAT_YUY2) {
+            for (int y = 0; y < height; y++) k->yuy2ToY8(Row(src, 0, y), Row(dst, 0, y), width);
+            return true;
+        }
+        if (sf == PXCImage::PIXEL_FORMAT_NV12) {
+            for (int y = 0; y < height; y++) memcpy(Row(dst, 0, y), Row(src, 0, y), width);
+            return true;
+        }
+        return false;
+    }
+    if (df == PXCImage::PIXEL_FORMAT_YUY2) {
+        if (sf != PXCImage::PIXEL_FORMAT_NV12 && sf != PXCImage::PIXEL_FORMAT_Y8) return false;
+        for (int y = 0; y < height; y++)
+            k->nv12ToYuy2(Row(src, 0, y), (sf == PXCImage::PIXEL_FORMAT_NV12) ? Row(src, 1, y / 2) : 0, Row(dst, 0, y), width);
+        return true;
+    }
+    if (df == PXCImage::PIXEL_FORMAT_NV12) {
+        if (sf != PXCImage::PIXEL_FORMAT_YUY2 && sf != PXCImage::PIXEL_FORMAT_Y8) return false;
+        for (int y = 0; y < height; y++) {
+            if (sf == PXCImage::PIXEL_FORMAT_YUY2) k->yuy2ToY8(Row(src, 0, y), Row(dst, 0, y), width);
+            else memcpy(Row(dst, 0, y), Row(src, 0, y), width);
+        }
+        for (int y = 0; y < (height + 1) / 2; y++) {
+            pxcBYTE *uv = Row(dst, 1, y);
+            if (sf == PXCImage::PIXEL_FORMAT_Y8) {
+                memset(uv, 128, cw);
+                continue;
+            }
+            k->yuy2ToNv12Chroma(Row(src, 0, y * 2), Row(src, 0, (y * 2 + 1 < height) ? y * 2 + 1 : y * 2), uv, width);
+        }
+        return true;
+    }
+    return false;
+}
+
+static pxcStatus ConvertColor(const ImageData *src, ImageData *dst, int width, int height) {
+    const KernelTable *k = Kernels();
+    if (ConvertYuv(k, src, dst, width, height)) return PXC_STATUS_NO_ERROR;
+
+    pxcBYTE grayLut[256];
+    for (int i = 0; i < 256; i++) grayLut[i] = Clamp8(((i - 16) * 298 + 128) >> 8);
+
+    pxcBYTE *scratch = (pxcBYTE*)malloc((size_t)width * 8);
+    if (!scratch) return PXC_STATUS_ALLOC_FAILED;
+    pxcBYTE *bgra0 = scratch, *bgra1 = scratch + (size_t)width * 4;
+
+    if (dst->format == PXCImage::PIXEL_FORMAT_NV12) {
+        for (int y = 0; y < height; y += 2) {
+            int y1 = (y + 1 < height) ? y + 1 : y;
+            DecodeRow(k, src, y, width, bgra0, grayLut);
+            DecodeRow(k, src, y1, width, bgra1, grayLut);
+            k->bgraToY8(bgra0, Row(dst, 0, y), width);
+            if (y1 != y) k->bgraToY8(bgra1, Row(dst, 0, y1), width);
+            k->bgraToNv12Chroma(bgra0, bgra1, Row(dst, 1, y / 2), width);
+        }
+    } else {
+        for (int y = 0; y < height; y++) {
+            const pxcBYTE *bgra = bgra0;
+            if (src->format == PXCImage::PIXEL_FORMAT_RGB32) {
+                bgra = Row(src, 0, y);
+            } else if (dst->format == PXCImage::PIXEL_FORMAT_RGB32) {
+                DecodeRow(k, src, y, width, Row(dst, 0, y), grayLut);
+                continue;
+            } else {
+                DecodeRow(k, src, y, width, bgra0, grayLut);
+            }
+            EncodeRow(k, bgra, dst, y, width);
+        }
+    }
+    free(scratch);
+    return PXC_STATUS_NO_ERROR;
+}
+
+/* Convert one row of depth values; the caller validated the formats and the unit. */
+static void ConvertDepthRow(const KernelTable *k, PXCImage::PixelFormat sf, const void *src, PXCImage::PixelFormat df, void *dst, int count, float depthUnit) {
+    /* the scale from the source to the destination unit: DEPTH and DEPTH_F32 are in millimeters */
+    float scale = 1.0f;
+    if (sf == PXCImage::PIXEL_FORMAT_DEPTH_RAW) scale = depthUnit / 1000.0f;
+    if (df == PXCImage::PIXEL_FORMAT_DEPTH_RAW) scale = 1000.0f / depthUnit;
+
+    if (df == PXCImage::PIXEL_FORMAT_DEPTH_F32) {
+        k->u16ToF32((const pxcU16*)src, (float*)dst, count, scale);
+    } else if (sf == PXCImage::PIXEL_FORMAT_DEPTH_F32) {
+        k->f32ToU16((const float*)src, (pxcU16*)dst, count, scale);
+    } else if (scale == 1.0f) {
+        memcpy(dst, src, (size_t)count * sizeof(pxcU16));
+    } else {
+        k->u16ToU16((const pxcU16*)src, (pxcU16*)dst, count, scale);
+    }
+}
+
+static pxcStatus ConvertDepth(const ImageData *src, ImageData *dst, int width, int height, float depthUnit) {
+    const KernelTable *k = Kernels();
+    for (int y = 0; y < height; y++)
+        ConvertDepthRow(k, src->format, Row(src, 0, y), dst->format, Row(dst, 0, y), width, depthUnit);
+    return PXC_STATUS_NO_ERROR;
+}
+
+/* The Y16 histogram bins 16 values each; the Y8_IR_RELATIVE histogram uses the first 256 bins. */
+enum { HISTOGRAM_BINS = 4096, HISTOGRAM_SHIFT_Y16 = 4 };
+
+/* Count the pixels into four interleaved histograms, so runs of equal pixels do not
+   serialize on one counter; bins[0] receives the total. */
+static void BuildHistogram(const ImageData *src, int width, int height, pxcI32 (*bins)[HISTOGRAM_BINS]) {
+    const int shift = HISTOGRAM_SHIFT_Y16;
+    for (int y = 0; y < height; y++) {
+        const pxcBYTE *row = Row(src, 0, y);
+        int x = 0;
+        if (src->format == PXCImage::PIXEL_FORMAT_Y16) {
+            const pxcU16 *p = (const pxcU16*)row;
+            for (; x + 4 <= width; x += 4) {
+                bins[0][p[x] >> shift]++;
+                bins[1][p[x + 1] >> shift]++;
+                bins[2][p[x + 2] >> shift]++;
+                bins[3][p[x + 3] >> shift]++;
+            }
+            for (; x < width; x++) bins[0][p[x] >> shift]++;
+        } else {
+            for (; x + 4 <= width; x += 4) {
+                bins[0][row[x]]++;
+                bins[1][row[x + 1]]++;
+                bins[2][row[x + 2]]++;
+                bins[3][row[x + 3]]++;
+            }
+            for (; x < width; x++) bins[0][row[x]]++;
+        }
+    }
+    for (int i = 0; i < HISTOGRAM_BINS; i++) bins[0][i] += bins[1][i] + bins[2][i] + bins[3][i];
+}
+
+/* Return the first bin where the cumulative count exceeds the percentile of the pixels. */
+static int FindPercentile(const pxcI32 *bins, int count, pxcF64 pixels, pxcF32 percentile) {
+    pxcF64 target = pixels * percentile / 100, sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += bins[i];
+        if (sum > target) return i;
+    }
+    return count - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+bool PXCImageConversion::IsSupported(PXCImage::PixelFormat src, PXCImage::PixelFormat dst) {
+    return (IsColorFormat(src) && IsColorFormat(dst)) || (IsDepthFormat(src) && IsDepthFormat(dst))
+        || (IsIrFormat(src) && dst == PXCImage::PIXEL_FORMAT_Y8);
+}
+
+pxcStatus PXCImageConversion::ToneMap(const PXCImage::ImageData *src, PXCImage::ImageData *dst, pxcI32 width, pxcI32 height, ToneMapping *toneMapping) {
+    if (!src || !dst || !src->planes[0] || !dst->planes[0]) return PXC_STATUS_HANDLE_INVALID;
+    if (width <= 0 || height <= 0 || !IsIrFormat(src->format) || dst->format != PXCImage::PIXEL_FORMAT_Y8) return PXC_STATUS_PARAM_UNSUPPORTED;
+    ToneMapping defaults;
+    if (!toneMapping) {
+        InitToneMapping(&defaults);
+        toneMapping = &defaults;
+    }
+    if (!(toneMapping->lowPercentile >= 0 && toneMapping->lowPercentile < toneMapping->highPercentile && toneMapping->highPercentile <= 100)
+        || !(toneMapping->smoothing >= 0 && toneMapping->smoothing < 1)) return PXC_STATUS_PARAM_UNSUPPORTED;
+
+    pxcI32 (*bins)[HISTOGRAM_BINS] = (pxcI32 (*)[HISTOGRAM_BINS])calloc(4, sizeof(*bins));
+    if (!bins) return PXC_STATUS_ALLOC_FAILED;
+    BuildHistogram(src, width, height, bins);
+    bool y16 = (src->format == PXCImage::PIXEL_FORMAT_Y16);
+    int shift = y16 ? HISTOGRAM_SHIFT_Y16 : 0, count = y16 ? HISTOGRAM_BINS : 256;
+    pxcF64 pixels = (pxcF64)width * height;
+    pxcF32 low = (pxcF32)(FindPercentile(bins[0], count, pixels, toneMapping->lowPercentile) << shift);
+    pxcF32 high = (pxcF32)(((FindPercentile(bins[0], count, pixels, toneMapping->highPercentile) + 1) << shift) - 1);
+    free(bins);
+
+    /* blend with the limits of the previous frame */
+    if (toneMapping->smoothing > 0 && toneMapping->low >= 0 && toneMapping->high >= toneMapping->low) {
+        low = toneMapping->smoothing * toneMapping->low + (1 - toneMapping->smoothing) * low;
+        high = toneMapping->smoothing * toneMapping->high + (1 - toneMapping->smoothing) * high;
+    }
+    toneMapping->low = low;
+    toneMapping->high = high;
+
+    int lo = (int)lrintf(low), hi = (int)lrintf(high);
+    if (hi <= lo) hi = lo + 1;
+    float scale = 255.0f / (hi - lo);
+    if (y16) {
+        const KernelTable *k = Kernels();
+        for (int y = 0; y < height; y++) k->y16ToY8((const pxcU16*)Row(src, 0, y), Row(dst, 0, y), width, lo, scale);
+    } else {
+        pxcBYTE lut[256];
+        for (int i = 0; i < 256; i++) lut[i] = StretchToY8(i, lo, scale);
+        for (int y = 0; y < height; y++) {
+            const pxcBYTE *s = Row(src, 0, y);
+            pxcBYTE *d = Row(dst, 0, y);
+            for (int x = 0; x < width; x++) d[x] = lut[s[x]];
+        }
+    }
+    return PXC_STATUS_NO_ERROR;
+}
+
+
+pxcStatus PXCImageConversion::ConvertDepth(PXCImage::PixelFormat srcFormat, const void *src, PXCImage::PixelFormat dstFormat, void *dst, pxcI32 count, pxcF32 depthUnit) {
+    if (!src || !dst) return PXC_STATUS_HANDLE_INVALID;
+    if (!IsDepthFormat(srcFormat) || !IsDepthFormat(dstFormat) || count < 0 || !(depthUnit > 0)) return PXC_STATUS_PARAM_UNSUPPORTED;
+    if (srcFormat == dstFormat) {
+        if (src != dst) memmove(dst, src, (size_t)count * BytesPerPixel(srcFormat));
+        return PXC_STATUS_NO_ERROR;
+    }
+    ConvertDepthRow(Kernels(), srcFormat, src, dstFormat, dst, count, depthUnit);
+    return PXC_STATUS_NO_ERROR;
+}
+
+pxcStatus PXCImageConversion::Convert(const PXCImage::ImageData *src, PXCImage::ImageData *dst, pxcI32 width, pxcI32 height, pxcF32 depthUnit, ToneMapping *toneMapping) {
+    if (!src || !dst) return PXC_STATUS_HANDLE_INVALID;
+    if (width <= 0 || height <= 0 || !(depthUnit > 0)) return PXC_STATUS_PARAM_UNSUPPORTED;
+    if (!IsSupported(src->format, dst->format)) return PXC_STATUS_PARAM_UNSUPPORTED;
+    for (int p = 0; p < PlaneCount(src->format); p++)
+        if (!src->planes[p]) return PXC_STATUS_HANDLE_INVALID;
+    for (int p = 0; p < PlaneCount(dst->format); p++)
+        if (!dst->planes[p]) return PXC_STATUS_HANDLE_INVALID;
+
+    if (src->format == dst->format) {
+        CopyImageData(src, dst, width, height);
+        return PXC_STATUS_NO_ERROR;
+    }
+    if (IsDepthFormat(src->format)) return ::ConvertDepth(src, dst, width, height, depthUnit);
+    if (IsIrFormat(src->format)) return ToneMap(src, dst, width, height, toneMapping);
+    return ConvertColor(src, dst, width, height);
+}
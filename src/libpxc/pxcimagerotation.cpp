@@ -0,0 +1,319 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "service/pxcimagerotation.h"
+#include "service/pxcimageconversion.h"
+#include "pxcsimd.h"
+#include <stddef.h>
+#include <string.h>
+
+/*
+   The 90 and 270 degree rotations are transposes with one of the images walked
+   bottom up:
+
+   90 degrees:  dst[x][height-1-y] = src[y][x], a transpose of src read with a negative stride
+   270 degrees: dst[width-1-x][y]  = src[y][x], a transpose written with a negative stride
+
+   The transposes walk TILE x TILE pixel tiles so the source and destination rows
+   of a tile stay in the cache, and transpose SIMD register sized blocks inside a
+   tile. NV12 rotates the luma plane as 8-bit pixels and the chroma plane as 16-bit
+   UV pairs; YUY2 shares chroma between pixel pairs and rotates per pixel.
+*/
+
+typedef PXCImage::ImageData ImageData;
+
+enum { TILE = 64 };
+
+/* Transpose w x h pixels of N bytes: dst row x, column y receives src row y, column x. */
+template <int N>
+static void TransposeRect_C(const pxcBYTE *src, ptrdiff_t srcStride, pxcBYTE *dst, ptrdiff_t dstStride, int x0, int y0, int x1, int y1) {
+    for (int x = x0; x < x1; x++) {
+        pxcBYTE *d = dst + x * dstStride + y0 * N;
+        const pxcBYTE *s = src + y0 * srcStride + x * N;
+        for (int y = y0; y < y1; y++, d += N, s += srcStride)
+            memcpy(d, s, N);
+    }
+}
+
+template <int N>
+static void Transpose_C(const pxcBYTE *src, ptrdiff_t srcStride, pxcBYTE *dst, ptrdiff_t dstStride, int width, int height) {
+    for (int ty = 0; ty < height; ty += TILE)
+        for (int tx = 0; tx < width; tx += TILE)
+            TransposeRect_C<N>(src, srcStride, dst, dstStride, tx, ty, (tx + TILE < width) ? tx + TILE : width, (ty + TILE < height) ? ty + TILE : height);
+}
+
+template <int N>
+static void ReverseRow_C(const pxcBYTE *src, pxcBYTE *dst, int x, int width) {
+    for (; x < width; x++)
+        memcpy(dst + (width - 1 - x) * N, src + x * N, N);
+}
+
+#ifdef PXC_SIMD_X86
+
+/* Transpose the full blocks of a tile with the block kernel, and the partial edges with the scalar kernel. */
+#define PXC_TRANSPOSE_TILED(N, B, BLOCK)                                                                \
+    for (int ty = 0; ty < height; ty += TILE) {                                                         \
+        int ty1 = (ty + TILE < height) ? ty + TILE : height, by1 = ty + (ty1 - ty) / B * B;             \
+        for (int tx = 0; tx < width; tx += TILE) {                                                      \
+            int tx1 = (tx + TILE < width) ? tx + TILE : width, bx1 = tx + (tx1 - tx) / B * B;           \
+            for (int y = ty; y < by1; y += B)                                                           \
+                for (int x = tx; x < bx1; x += B)                                                       \
+                    BLOCK(src + y * srcStride + x * N, srcStride, dst + x * dstStride + y * N, dstStride); \
+            TransposeRect_C<N>(src, srcStride, dst, dstStride, bx1, ty, tx1, ty1);                      \
+            TransposeRect_C<N>(src, srcStride, dst, dstStride, tx, by1, bx1, ty1);                      \
+        }                                                                                               \
+    }
+
+/* 16x16 bytes in four interleave stages: 8-bit, 16-bit, 32-bit and 64-bit units. */
+static inline PXC_TARGET_SSE41 void Transpose8Block_SSE41(const pxcBYTE *src, ptrdiff_t srcStride, pxcBYTE *dst, ptrdiff_t dstStride) {
+    __m128i r[16], a[16], b[16], c[16];
+    for (int i = 0; i < 16; i++) r[i] = _mm_loadu_si128((const __m128i*)(src + i * srcStride));
+    /* a[k]: columns 0-7, a[8+k]: columns 8-15, rows 2k..2k+1 */
+    for (int k = 0; k < 8; k++) {
+        a[k] = _mm_unpacklo_epi8(r[2 * k], r[2 * k + 1]);
+        a[8 + k] = _mm_unpackhi_epi8(r[2 * k], r[2 * k + 1]);
+    }
+    /* b[4q+m]: columns 4q..4q+3, rows 4m..4m+3 */
+    for (int h = 0; h < 2; h++) {
+        for (int m = 0; m < 4; m++) {
+            b[8 * h + m] = _mm_unpacklo_epi16(a[8 * h + 2 * m], a[8 * h + 2 * m + 1]);
+            b[8 * h + 4 + m] = _mm_unpackhi_epi16(a[8 * h + 2 * m], a[8 * h + 2 * m + 1]);
+        }
+    }
+    /* c[4q+0..1]: columns 4q,4q+1 and c[4q+2..3]: columns 4q+2,4q+3, rows 0-7 then 8-15 */
+    for (int q = 0; q < 4; q++) {
+        c[4 * q + 0] = _mm_unpacklo_epi32(b[4 * q + 0], b[4 * q + 1]);
+        c[4 * q + 1] = _mm_unpacklo_epi32(b[4 * q + 2], b[4 * q + 3]);
+        c[4 * q + 2] = _mm_unpackhi_epi32(b[4 * q + 0], b[4 * q + 1]);
+        c[4 * q + 3] = _mm_unpackhi_epi32(b[4 * q + 2], b[4 * q + 3]);
+    }
+    for (int q = 0; q < 4; q++) {
+        _mm_storeu_si128((__m128i*)(dst + (4 * q + 0) * dstStride), _mm_unpacklo_epi64(c[4 * q + 0], c[4 * q + 1]));
+        _mm_storeu_si128((__m128i*)(dst + (4 * q + 1) * dstStride), _mm_unpackhi_epi64(c[4 * q + 0], c[4 * q + 1]));
+        _mm_storeu_si128((__m128i*)(dst + (4 * q + 2) * dstStride), _mm_unpacklo_epi64(c[4 * q + 2], c[4 * q + 3]));
+        _mm_storeu_si128((__m128i*)(dst + (4 * q + 3) * dstStride), _mm_unpackhi_epi64(c[4 * q + 2], c[4 * q + 3]));
+    }
+}
+
+/* 8x8 16-bit pixels in three interleave stages. */
+static inline PXC_TARGET_SSE41 void Transpose16Block_SSE41(const pxcBYTE *src, ptrdiff_t srcStride, pxcBYTE *dst, ptrdiff_t dstStride) {
+    __m128i r[8], a[8], b[8];
+    for (int i = 0; i < 8; i++) r[i] = _mm_loadu_si128((const __m128i*)(src + i * srcStride));
+    /* a[k]: columns 0-3, a[4+k]: columns 4-7, rows 2k..2k+1 */
+    for (int k = 0; k < 4; k++) {
+        a[k] = _mm_unpacklo_epi16(r[2 * k], r[2 * k + 1]);
+        a[4 + k] = _mm_unpackhi_epi16(r[2 * k], r[2 * k + 1]);
+    }
+    /* b[4h+0..1]: columns 4h,4h+1 and b[4h+2..3]: columns 4h+2,4h+3, rows 0-3 then 4-7 */
+    for (int h = 0; h < 2; h++) {
+        b[4 * h + 0] = _mm_unpacklo_epi32(a[4 * h + 0], a[4 * h + 1]);
+        b[4 * h + 1] = _mm_unpacklo_epi32(a[4 * h + 2], a[4 * h + 3]);
+        b[4 * h + 2] = _mm_unpackhi_epi32(a[4 * h + 0], a[4 * h + 1]);
+        b[4 * h + 3] = _mm_unpackhi_epi32(a[4 * h + 2], a[4 * h + 3]);
+    }
+    for (int h = 0; h < 2; h++) {
+        _mm_storeu_si128((__m128i*)(dst + (4 * h + 0) * dstStride), _mm_unpacklo_epi64(b[4 * h + 0], b[4 * h + 1]));
+        _mm_storeu_si128((__m128i*)(dst + (4 * h + 1) * dstStride), _mm_unpackhi_epi64(b[4 * h + 0], b[4 * h + 1]));
+        _mm_storeu_si128((__m128i*)(dst + (4 * h + 2) * dstStride), _mm_unpacklo_epi64(b[4 * h + 2], b[4 * h + 3]));
+        _mm_storeu_si128((__m128i*)(dst + (4 * h + 3) * dstStride), _mm_unpackhi_epi64(b[4 * h + 2], b[4 * h + 3]));
+    }
+}
+
+/* 4x4 32-bit pixels in two interleave stages. */
+static inline PXC_TARGET_SSE41 void Transpose32Block_SSE41(const pxcBYTE *src, ptrdiff_t srcStride, pxcBYTE *dst, ptrdiff_t dstStride) {
+    __m128i r0 = _mm_loadu_si128((const __m128i*)(src));
+    __m128i r1 = _mm_loadu_si128((const __m128i*)(src + srcStride));
+    __m128i r2 = _mm_loadu_si128((const __m128i*)(src + 2 * srcStride));
+    __m128i r3 = _mm_loadu_si128((const __m128i*)(src + 3 * srcStride));
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t2 = _mm_unpacklo_epi32(r2, r3), t3 = _mm_unpackhi_epi32(r2, r3);
+    _mm_storeu_si128((__m128i*)(dst), _mm_unpacklo_epi64(t0, t2));
+    _mm_storeu_si128((__m128i*)(dst + dstStride), _mm_unpackhi_epi64(t0, t2));
+    _mm_storeu_si128((__m128i*)(dst + 2 * dstStride), _mm_unpacklo_epi64(t1, t3));
+    _mm_storeu_si128((__m128i*)(dst + 3 * dstStride), _mm_unpackhi_epi64(t1, t3));
+}
+
+static PXC_TARGET_SSE41 void Transpose8_SSE41(const pxcBYTE *src, ptrdiff_t srcStride, pxcBYTE *dst, ptrdiff_t dstStride, int width, int height) {
+    PXC_TRANSPOSE_TILED(1, 16, Transpose8Block_SSE41)
+}
+
+static PXC_TARGET_SSE41 void Transpose16_SSE41(const pxcBYTE *src, ptrdiff_t srcStride, pxcBYTE *dst, ptrdiff_t dstStride, int width, int height) {
+    PXC_TRANSPOSE_TILED(2, 8, Transpose16Block_SSE41)
+}
+
+static PXC_TARGET_SSE41 void Transpose32_SSE41(const pxcBYTE *src, ptrdiff_t srcStride, pxcBYTE *dst, ptrdiff_t dstStride, int width, int height) {
+    PXC_TRANSPOSE_TILED(4, 4, Transpose32Block_SSE41)
+}
+
+#undef PXC_TRANSPOSE_TILED
+
+static PXC_TARGET_SSE41 void ReverseRow8_SSE41(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m128i mask = _mm_setr_epi8(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+        _mm_storeu_si128((__m128i*)(dst + width - 16 - x), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + x)), mask));
+    ReverseRow_C<1>(src, dst, x, width);
+}
+
+static PXC_TARGET_SSE41 void ReverseRow16_SSE41(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    const __m128i mask = _mm_setr_epi8(14,15,12,13,10,11,8,9,6,7,4,5,2,3,0,1);
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+        _mm_storeu_si128((__m128i*)(dst + (width - 8 - x) * 2), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + x * 2)), mask));
+    ReverseRow_C<2>(src, dst, x, width);
+}
+
+static PXC_TARGET_SSE41 void ReverseRow32_SSE41(const pxcBYTE *src, pxcBYTE *dst, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+        _mm_storeu_si128((__m128i*)(dst + (width - 4 - x) * 4), _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(src + x * 4)), 0x1B));
+    ReverseRow_C<4>(src, dst, x, width);
+}
+
+#endif /* PXC_SIMD_X86 */
+
+static void ReverseRow8_C(const pxcBYTE *src, pxcBYTE *dst, int width) { ReverseRow_C<1>(src, dst, 0, width); }
+static void ReverseRow16_C(const pxcBYTE *src, pxcBYTE *dst, int width) { ReverseRow_C<2>(src, dst, 0, width); }
+static void ReverseRow24_C(const pxcBYTE *src, pxcBYTE *dst, int width) { ReverseRow_C<3>(src, dst, 0, width); }
+static void ReverseRow32_C(const pxcBYTE *src, pxcBYTE *dst, int width) { ReverseRow_C<4>(src, dst, 0, width); }
+
+///////////////////////////////////////////////////////////////////////////////////////
+/* kernel dispatch by pixel size */
+
+typedef void (*TransposeFunc)(const pxcBYTE *src, ptrdiff_t srcStride, pxcBYTE *dst, ptrdiff_t dstStride, int width, int height);
+typedef void (*ReverseFunc)(const pxcBYTE *src, pxcBYTE *dst, int width);
+
+struct PlaneKernels {
+    TransposeFunc   transpose;
+    ReverseFunc     reverse;
+};
+
+static PlaneKernels SelectKernels(int pixelBytes) {
+    PlaneKernels k = { 0, 0 };
+#ifdef PXC_SIMD_X86
+    if (PXCImageConversion::QueryCpuFeatures() & PXCImageConversion::CPU_FEATURE_SSE41) {
+        switch (pixelBytes) {
+        case 1: k.transpose = Transpose8_SSE41;  k.reverse = ReverseRow8_SSE41;  return k;
+        case 2: k.transpose = Transpose16_SSE41; k.reverse = ReverseRow16_SSE41; return k;
+        case 4: k.transpose = Transpose32_SSE41; k.reverse = ReverseRow32_SSE41; return k;
+        }
+    }
+#endif
+    switch (pixelBytes) {
+    case 1: k.transpose = Transpose_C<1>; k.reverse = ReverseRow8_C;  break;
+    case 2: k.transpose = Transpose_C<2>; k.reverse = ReverseRow16_C; break;
+    case 3: k.transpose = Transpose_C<3>; k.reverse = ReverseRow24_C; break;
+    case 4: k.transpose = Transpose_C<4>; k.reverse = ReverseRow32_C; break;
+    }
+    return k;
+}
+
+static int PixelBytes(PXCImage::PixelFormat format) {
+    switch (format) {
+    case PXCImage::PIXEL_FORMAT_Y8:
+    case PXCImage::PIXEL_FORMAT_Y8_IR_RELATIVE:
+    case PXCImage::PIXEL_FORMAT_NV12:       return 1;
+    case PXCImage::PIXEL_FORMAT_Y16:
+    case PXCImage::PIXEL_FORMAT_DEPTH:
+    case PXCImage::PIXEL_FORMAT_DEPTH_RAW:  return 2;
+    case PXCImage::PIXEL_FORMAT_RGB24:      return 3;
+    case PXCImage::PIXEL_FORMAT_RGB32:
+    case PXCImage::PIXEL_FORMAT_DEPTH_F32:  return 4;
+    default:                                return 0;
+    }
+}
+
+/* Rotate one plane of width x height pixels. */
+static void RotatePlane(const PlaneKernels &k, const pxcBYTE *src, pxcI32 srcPitch, pxcBYTE *dst, pxcI32 dstPitch, int width, int height, PXCImage::Rotation rotation) {
+    switch (rotation) {
+    case PXCImage::ROTATION_90_DEGREE:
+        k.transpose(src + (ptrdiff_t)(height - 1) * srcPitch, -(ptrdiff_t)srcPitch, dst, dstPitch, width, height);
+        break;
+    case PXCImage::ROTATION_270_DEGREE:
+        k.transpose(src, srcPitch, dst + (ptrdiff_t)(width - 1) * dstPitch, -(ptrdiff_t)dstPitch, width, height);
+        break;
+    case PXCImage::ROTATION_180_DEGREE:
+        for (int y = 0; y < height; y++)
+            k.reverse(src + (ptrdiff_t)y * srcPitch, dst + (ptrdiff_t)(height - 1 - y) * dstPitch, width);
+        break;
+    default:
+        break;
+    }
+}
+
+/* YUY2 pixel pairs share chroma; each destination pair averages the chroma of its two source pixels. */
+static void RotateYuy2(const ImageData *src, ImageData *dst, int width, int height, PXCImage::Rotation rotation) {
+    int rw = width, rh = height;
+    PXCImageRotation::QueryRotatedSize(width, height, rotation, &rw, &rh);
+    for (int y = 0; y < rh; y++) {
+        pxcBYTE *d = dst->planes[0] + (ptrdiff_t)y * dst->pitches[0];
+        for (int x = 0; x < rw; x += 2) {
+            int yuv[2][3];
+            for (int i = 0; i < 2; i++) {
+                int dx = (x + i < rw) ? x + i : x, sx, sy;
+                switch (rotation) {
+                case PXCImage::ROTATION_90_DEGREE:  sx = y; sy = height - 1 - dx; break;
+                case PXCImage::ROTATION_270_DEGREE: sx = width - 1 - y; sy = dx; break;
+                default:                            sx = width - 1 - dx; sy = height - 1 - y; break;
+                }
+                const pxcBYTE *s = src->planes[0] + (ptrdiff_t)sy * src->pitches[0] + (sx & ~1) * 2;
+                yuv[i][0] = s[(sx & 1) * 2];
+                yuv[i][1] = s[1];
+                yuv[i][2] = s[3];
+            }
+            d[x * 2] = (pxcBYTE)yuv[0][0];
+            d[x * 2 + 1] = (pxcBYTE)((yuv[0][1] + yuv[1][1] + 1) >> 1);
+            d[x * 2 + 2] = (pxcBYTE)yuv[1][0];
+            d[x * 2 + 3] = (pxcBYTE)((yuv[0][2] + yuv[1][2] + 1) >> 1);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+bool PXCImageRotation::IsSupported(PXCImage::PixelFormat format) {
+    return format == PXCImage::PIXEL_FORMAT_YUY2 || PixelBytes(format) > 0;
+}
+
+pxcStatus PXCImageRotation::Rotate(const PXCImage::ImageData *src, PXCImage::ImageData *dst, pxcI32 width, pxcI32 height, PXCImage::Rotation rotation) {
+    if (!src || !dst || !src->planes[0] || !dst->planes[0]) return PXC_STATUS_HANDLE_INVALID;
+    if (width <= 0 || height <= 0 || !IsSupported(src->format) || dst->format != src->format) return PXC_STATUS_PARAM_UNSUPPORTED;
+    if (rotation != PXCImage::ROTATION_90_DEGREE && rotation != PXCImage::ROTATION_180_DEGREE && rotation != PXCImage::ROTATION_270_DEGREE)
+        return PXC_STATUS_PARAM_UNSUPPORTED;
+
+    if (src->format == PXCImage::PIXEL_FORMAT_YUY2) {
+        RotateYuy2(src, dst, width, height, rotation);
+        return PXC_STATUS_NO_ERROR;
+    }
+
+    int pixelBytes = PixelBytes(src->format);
+    RotatePlane(SelectKernels(pixelBytes), src->planes[0], src->pitches[0], dst->planes[0], dst->pitches[0], width, height, rotation);
+    if (src->format == PXCImage::PIXEL_FORMAT_NV12) {
+        if (!src->planes[1] || !dst->planes[1]) return PXC_STATUS_HANDLE_INVALID;
+        RotatePlane(SelectKernels(2), src->planes[1], src->pitches[1], dst->planes[1], dst->pitches[1], (width + 1) / 2, (height + 1) / 2, rotation);
+    }
+    return PXC_STATUS_NO_ERROR;
+}
@@ -0,0 +1,286 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "service/pxcimagescaling.h"
+#include "service/pxcimageconversion.h"
+#include "pxcsimd.h"
+#include <stddef.h>
+
+/*
+   Every kernel reduces two source rows to one destination row. An 8-bit row is
+   processed in groups of bytes; each destination byte of a group is the rounded
+   average of a pair of bytes of the group in both rows:
+
+   Y8:    [Y0 Y1]                       -> Y0+Y1
+   UV:    [U0 V0 U1 V1]                 -> U0+U1, V0+V1
+   BGR:   [B0 G0 R0 B1 G1 R1]           -> B0+B1, G0+G1, R0+R1
+   BGRA:  [B0 G0 R0 A0 B1 G1 R1 A1]     -> B0+B1, G0+G1, R0+R1, A0+A1
+   YUY2:  [Y0 U0 Y1 V0 Y2 U1 Y3 V1]     -> Y0+Y1, U0+U1, Y2+Y3, V0+V1
+
+   The second half of a group is the second pixel (or YUY2 pixel pair), so a partial
+   last group pairs its first half with itself. The SIMD kernels gather the pairs
+   with one byte shuffle and add them with a multiply-add by one.
+
+   The depth filters treat zero as invalid. Subtracting one with wraparound maps
+   invalid depth above all valid depths, so the minimum of the shifted values is the
+   nearest valid depth, and the second smallest is the lower median when at least
+   three depths are valid. Adding one back maps an all invalid block to zero.
+*/
+
+typedef PXCImage::ImageData ImageData;
+
+struct ByteGroup {
+    int     size;           /* source bytes per group */
+    pxcBYTE pairs[4][2];    /* source byte offsets of each destination byte */
+};
+
+static const ByteGroup g_groupY8   = { 2, { { 0, 1 } } };
+static const ByteGroup g_groupUV   = { 4, { { 0, 2 }, { 1, 3 } } };
+static const ByteGroup g_groupBGR  = { 6, { { 0, 3 }, { 1, 4 }, { 2, 5 } } };
+static const ByteGroup g_groupBGRA = { 8, { { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } } };
+static const ByteGroup g_groupYUY2 = { 8, { { 0, 2 }, { 1, 5 }, { 4, 6 }, { 3, 7 } } };
+
+typedef void (*BoxRow8)(const pxcBYTE *r0, const pxcBYTE *r1, pxcBYTE *dst, int srcBytes, const ByteGroup &group);
+typedef void (*DepthRow16)(const pxcU16 *r0, const pxcU16 *r1, pxcU16 *dst, int width, PXCImagePyramid::Filter filter);
+
+/* Box filter bytes from srcByte on; srcByte is a multiple of the group size. */
+static void BoxRow8Tail_C(const pxcBYTE *r0, const pxcBYTE *r1, pxcBYTE *dst, int srcByte, int srcBytes, const ByteGroup &group) {
+    int half = group.size / 2;
+    for (int g = srcByte; g < srcBytes; g += group.size) {
+        int shift = (g + group.size <= srcBytes) ? 0 : half;
+        pxcBYTE *d = dst + g / 2;
+        for (int k = 0; k < half; k++) {
+            int i = group.pairs[k][0], j = group.pairs[k][1];
+            if (i >= half) i -= shift;
+            if (j >= half) j -= shift;
+            i += g;
+            j += g;
+            d[k] = (pxcBYTE)((r0[i] + r0[j] + r1[i] + r1[j] + 2) >> 2);
+        }
+    }
+}
+
+static void BoxRow8_C(const pxcBYTE *r0, const pxcBYTE *r1, pxcBYTE *dst, int srcBytes, const ByteGroup &group) {
+    BoxRow8Tail_C(r0, r1, dst, 0, srcBytes, group);
+}
+
+static void BoxRow16_C(const pxcU16 *r0, const pxcU16 *r1, pxcU16 *dst, int width) {
+    for (int x = 0; x < width; x += 2) {
+        int x1 = (x + 1 < width) ? x + 1 : x;
+        dst[x / 2] = (pxcU16)((r0[x] + r0[x1] + r1[x] + r1[x1] + 2) >> 2);
+    }
+}
+
+/* The lower median of the valid values of a, b, c, d, shifted by minus one. */
+static inline pxcU16 MedianShifted(pxcU16 a, pxcU16 b, pxcU16 c, pxcU16 d) {
+    pxcU16 lo1 = a < b ? a : b, hi1 = a < b ? b : a;
+    pxcU16 lo2 = c < d ? c : d, hi2 = c < d ? d : c;
+    pxcU16 s0 = lo1 < lo2 ? lo1 : lo2, m1 = lo1 < lo2 ? lo2 : lo1;
+    pxcU16 m2 = hi1 < hi2 ? hi1 : hi2;
+    pxcU16 s1 = m1 < m2 ? m1 : m2, s2 = m1 < m2 ? m2 : m1;
+    return (s2 != 0xFFFF) ? s1 : s0;
+}
+
+static void DepthRow16Tail_C(const pxcU16 *r0, const pxcU16 *r1, pxcU16 *dst, int x, int width, PXCImagePyramid::Filter filter) {
+    for (; x < width; x += 2) {
+        int x1 = (x + 1 < width) ? x + 1 : x;
+        pxcU16 a = (pxcU16)(r0[x] - 1), b = (pxcU16)(r0[x1] - 1), c = (pxcU16)(r1[x] - 1), d = (pxcU16)(r1[x1] - 1);
+        pxcU16 v;
+        if (filter == PXCImagePyramid::FILTER_MIN_VALID) {
+            v = a < b ? a : b;
+            if (c < v) v = c;
+            if (d < v) v = d;
+        } else {
+            v = MedianShifted(a, b, c, d);
+        }
+        dst[x / 2] = (pxcU16)(v + 1);
+    }
+}
+
+static void DepthRow16_C(const pxcU16 *r0, const pxcU16 *r1, pxcU16 *dst, int width, PXCImagePyramid::Filter filter) {
+    DepthRow16Tail_C(r0, r1, dst, 0, width, filter);
+}
+
+static inline bool IsValidDepth(pxcF32 v) { return v > 0; }
+
+static void DepthRowF32_C(const pxcF32 *r0, const pxcF32 *r1, pxcF32 *dst, int width, PXCImagePyramid::Filter filter) {
+    for (int x = 0; x < width; x += 2) {
+        int x1 = (x + 1 < width) ? x + 1 : x;
+        pxcF32 block[4] = { r0[x], r0[x1], r1[x], r1[x1] }, valid[4];
+        int n = 0;
+        for (int i = 0; i < 4; i++) {
+            if (!IsValidDepth(block[i])) continue;
+            int j = n++;
+            for (; j > 0 && valid[j - 1] > block[i]; j--) valid[j] = valid[j - 1];
+            valid[j] = block[i];
+        }
+        if (!n) dst[x / 2] = 0;
+        else dst[x / 2] = (filter == PXCImagePyramid::FILTER_MIN_VALID) ? valid[0] : valid[(n - 1) / 2];
+    }
+}
+
+#ifdef PXC_SIMD_X86
+
+/* 16 source bytes (12 for BGR) to 8 (6) destination bytes per iteration. */
+static PXC_TARGET_SSE41 void BoxRow8_SSE41(const pxcBYTE *r0, const pxcBYTE *r1, pxcBYTE *dst, int srcBytes, const ByteGroup &group) {
+    pxcBYTE shuffle[16];
+    int groups = 16 / group.size, half = group.size / 2, step = groups * group.size;
+    for (int i = 0; i < 16; i++) shuffle[i] = 0x80;
+    for (int g = 0; g < groups; g++) {
+        for (int k = 0; k < half; k++) {
+            shuffle[(g * half + k) * 2] = (pxcBYTE)(g * group.size + group.pairs[k][0]);
+            shuffle[(g * half + k) * 2 + 1] = (pxcBYTE)(g * group.size + group.pairs[k][1]);
+        }
+    }
+    const __m128i mask = _mm_loadu_si128((const __m128i*)shuffle);
+    const __m128i ones = _mm_set1_epi8(1), two = _mm_set1_epi16(2);
+    int full = srcBytes / group.size * group.size, x = 0;
+    for (; x + 16 <= full; x += step) {
+        __m128i a = _mm_maddubs_epi16(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(r0 + x)), mask), ones);
+        __m128i b = _mm_maddubs_epi16(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(r1 + x)), mask), ones);
+        __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a, b), two), 2);
+        _mm_storel_epi64((__m128i*)(dst + x / 2), _mm_packus_epi16(sum, sum));
+    }
+    BoxRow8Tail_C(r0, r1, dst, x, srcBytes, group);
+}
+
+/* 16 source depths to 8 destination depths per iteration. */
+static PXC_TARGET_SSE41 void DepthRow16_SSE41(const pxcU16 *r0, const pxcU16 *r1, pxcU16 *dst, int width, PXCImagePyramid::Filter filter) {
+    const __m128i even = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i odd = _mm_setr_epi8(2, 3, 6, 7, 10, 11, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i one = _mm_set1_epi16(1), invalid = _mm_set1_epi16(-1);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i r00 = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(r0 + x)), one);
+        __m128i r01 = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(r0 + x + 8)), one);
+        __m128i r10 = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(r1 + x)), one);
+        __m128i r11 = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(r1 + x + 8)), one);
+        __m128i a = _mm_unpacklo_epi64(_mm_shuffle_epi8(r00, even), _mm_shuffle_epi8(r01, even));
+        __m128i b = _mm_unpacklo_epi64(_mm_shuffle_epi8(r00, odd), _mm_shuffle_epi8(r01, odd));
+        __m128i c = _mm_unpacklo_epi64(_mm_shuffle_epi8(r10, even), _mm_shuffle_epi8(r11, even));
+        __m128i d = _mm_unpacklo_epi64(_mm_shuffle_epi8(r10, odd), _mm_shuffle_epi8(r11, odd));
+        __m128i lo1 = _mm_min_epu16(a, b), lo2 = _mm_min_epu16(c, d), v;
+        if (filter == PXCImagePyramid::FILTER_MIN_VALID) {
+            v = _mm_min_epu16(lo1, lo2);
+        } else {
+            __m128i hi1 = _mm_max_epu16(a, b), hi2 = _mm_max_epu16(c, d);
+            __m128i m1 = _mm_max_epu16(lo1, lo2), m2 = _mm_min_epu16(hi1, hi2);
+            __m128i s2 = _mm_max_epu16(m1, m2);
+            v = _mm_blendv_epi8(_mm_min_epu16(m1, m2), _mm_min_epu16(lo1, lo2), _mm_cmpeq_epi16(s2, invalid));
+        }
+        _mm_storeu_si128((__m128i*)(dst + x / 2), _mm_add_epi16(v, one));
+    }
+    DepthRow16Tail_C(r0, r1, dst, x, width, filter);
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////
+
+static const ByteGroup *QueryByteGroup(PXCImage::PixelFormat format, int plane) {
+    switch (format) {
+    case PXCImage::PIXEL_FORMAT_Y8:
+    case PXCImage::PIXEL_FORMAT_Y8_IR_RELATIVE: return &g_groupY8;
+    case PXCImage::PIXEL_FORMAT_NV12:           return plane ? &g_groupUV : &g_groupY8;
+    case PXCImage::PIXEL_FORMAT_RGB24:          return &g_groupBGR;
+    case PXCImage::PIXEL_FORMAT_RGB32:          return &g_groupBGRA;
+    case PXCImage::PIXEL_FORMAT_YUY2:           return &g_groupYUY2;
+    default:                                    return 0;
+    }
+}
+
+static BoxRow8 SelectBoxRow8(void) {
+#ifdef PXC_SIMD_X86
+    if (PXCImageConversion::QueryCpuFeatures() & PXCImageConversion::CPU_FEATURE_SSE41) return BoxRow8_SSE41;
+#endif
+    return BoxRow8_C;
+}
+
+static DepthRow16 SelectDepthRow16(void) {
+#ifdef PXC_SIMD_X86
+    if (PXCImageConversion::QueryCpuFeatures() & PXCImageConversion::CPU_FEATURE_SSE41) return DepthRow16_SSE41;
+#endif
+    return DepthRow16_C;
+}
+
+bool PXCImageScaling::IsSupported(PXCImage::PixelFormat format, PXCImagePyramid::Filter filter) {
+    if (filter == PXCImagePyramid::FILTER_DEFAULT) filter = QueryDefaultFilter(format);
+    switch (format) {
+    case PXCImage::PIXEL_FORMAT_DEPTH:
+    case PXCImage::PIXEL_FORMAT_DEPTH_RAW:
+    case PXCImage::PIXEL_FORMAT_DEPTH_F32:
+        return filter == PXCImagePyramid::FILTER_MIN_VALID || filter == PXCImagePyramid::FILTER_MEDIAN_VALID;
+    case PXCImage::PIXEL_FORMAT_Y16:
+        return filter == PXCImagePyramid::FILTER_BOX;
+    default:
+        return QueryByteGroup(format, 0) && filter == PXCImagePyramid::FILTER_BOX;
+    }
+}
+
+pxcStatus PXCImageScaling::Downscale(const PXCImage::ImageData *src, PXCImage::ImageData *dst, pxcI32 width, pxcI32 height, PXCImagePyramid::Filter filter) {
+    if (!src || !dst || !src->planes[0] || !dst->planes[0]) return PXC_STATUS_HANDLE_INVALID;
+    if (width <= 0 || height <= 0 || dst->format != src->format || !IsSupported(src->format, filter)) return PXC_STATUS_PARAM_UNSUPPORTED;
+    if (filter == PXCImagePyramid::FILTER_DEFAULT) filter = QueryDefaultFilter(src->format);
+
+    BoxRow8 boxRow8 = SelectBoxRow8();
+    DepthRow16 depthRow16 = SelectDepthRow16();
+    int halfWidth, halfHeight;
+    QueryHalfSize(width, height, &halfWidth, &halfHeight);
+    for (int p = 0; p < (src->format == PXCImage::PIXEL_FORMAT_NV12 ? 2 : 1); p++) {
+        if (!src->planes[p] || !dst->planes[p]) return PXC_STATUS_HANDLE_INVALID;
+        /* the NV12 chroma plane is (width+1)/2 UV pairs by (height+1)/2 rows */
+        int rows = p ? (height + 1) / 2 : height, dstRows = p ? (halfHeight + 1) / 2 : halfHeight;
+        for (int y = 0; y < dstRows; y++) {
+            const pxcBYTE *r0 = src->planes[p] + (ptrdiff_t)(2 * y) * src->pitches[p];
+            const pxcBYTE *r1 = (2 * y + 1 < rows) ? r0 + src->pitches[p] : r0;
+            pxcBYTE *d = dst->planes[p] + (ptrdiff_t)y * dst->pitches[p];
+            switch (src->format) {
+            case PXCImage::PIXEL_FORMAT_DEPTH:
+            case PXCImage::PIXEL_FORMAT_DEPTH_RAW:
+                depthRow16((const pxcU16*)r0, (const pxcU16*)r1, (pxcU16*)d, width, filter);
+                break;
+            case PXCImage::PIXEL_FORMAT_DEPTH_F32:
+                DepthRowF32_C((const pxcF32*)r0, (const pxcF32*)r1, (pxcF32*)d, width, filter);
+                break;
+            case PXCImage::PIXEL_FORMAT_Y16:
+                BoxRow16_C((const pxcU16*)r0, (const pxcU16*)r1, (pxcU16*)d, width);
+                break;
+            default: {
+                const ByteGroup &group = *QueryByteGroup(src->format, p);
+                int srcBytes;
+                switch (src->format) {
+                case PXCImage::PIXEL_FORMAT_YUY2:   srcBytes = ((width + 1) & ~1) * 2; break;
+                case PXCImage::PIXEL_FORMAT_NV12:   srcBytes = p ? (width + 1) & ~1 : width; break;
+                default:                            srcBytes = width * group.size / 2; break;
+                }
+                boxRow8(r0, r1, d, srcBytes, group);
+                break;
+            }
+            }
+        }
+    }
+    return PXC_STATUS_NO_ERROR;
+}
@@ -0,0 +1,77 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/* Instruction set detection and function target attributes shared by the image kernels. */
+#pragma once
+#include "pxcdefs.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PXC_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PXC_TARGET_SSE41    __attribute__((target("sse4.1")))
+#define PXC_TARGET_AVX2     __attribute__((target("avx2")))
+#define PXC_TARGET_AVX512   __attribute__((target("avx512f,avx512bw")))
+#else
+#define PXC_TARGET_SSE41
+#define PXC_TARGET_AVX2
+#define PXC_TARGET_AVX512
+#endif
+
+/* The bit values match PXCImageConversion::CpuFeature. */
+#define PXC_SIMD_SSE41      0x00000001
+#define PXC_SIMD_AVX2       0x00000002
+#define PXC_SIMD_AVX512     0x00000004
+
+/* Return the instruction sets supported by both the processor and the operating system. */
+static inline pxcI32 PXCSimd_DetectCpuFeatures(void) {
+    pxcI32 features = 0;
+#if defined(PXC_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) features |= PXC_SIMD_SSE41;
+    if (__builtin_cpu_supports("avx2")) features |= PXC_SIMD_AVX2;
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) features |= PXC_SIMD_AVX512;
+#elif defined(PXC_SIMD_X86) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    int nids = regs[0];
+    __cpuid(regs, 1);
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    if (regs[2] & (1 << 19)) features |= PXC_SIMD_SSE41;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    if (nids >= 7) {
+        __cpuidex(regs, 7, 0);
+        if ((regs[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6) features |= PXC_SIMD_AVX2;
+        if ((regs[1] & (1 << 16)) && (regs[1] & (1 << 30)) && (xcr0 & 0xE6) == 0xE6) features |= PXC_SIMD_AVX512;
+    }
+#endif
+    return features;
+}
@@ -0,0 +1,134 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/* Measures the contended AddRef/Release throughput of PXCAddRefImpl counters, and
+   how much reference traffic slows down readers of the object's other fields. */
+#include "pxcaddref.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+/* The counter PXCAddRefImpl used before PXCRefCount: sequentially consistent
+   operations on a counter that shares its cache line with the object data. */
+class SeqCstRefCount {
+public:
+    explicit SeqCstRefCount(pxcI32 count = 1) { Reset(count); }
+    void   Reset(pxcI32 count = 1) { m_count = count; }
+    pxcI32 Increment(void) { return ++m_count; }
+    pxcI32 Decrement(void) { return --m_count; }
+    pxcI32 Query(void) const { return m_count; }
+
+protected:
+    std::atomic<int> m_count;
+};
+
+class Frame:public PXCBase {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('B','F','R','M'));
+};
+
+/* A reference counted object with a field that readers poll, like a frame time stamp. */
+template <class Counter>
+class Object:public PXCAddRefImpl<PXCBaseImpl<Frame>, Counter> {
+public:
+    Object(void):timeStamp(1) {}
+    pxcI64 QueryTimeStamp(void) const { return timeStamp; }
+
+    volatile pxcI64 timeStamp;
+};
+
+struct Result {
+    double  refsPerSecond;      /* AddRef/Release pairs per second, all threads */
+    double  readsPerSecond;     /* reads of the time stamp per second, while references change */
+};
+
+template <class Counter>
+static Result Run(int nthreads, pxcI64 iterations) {
+    Object<Counter> *object = new Object<Counter>();
+    std::atomic<int> ready(0);
+    std::atomic<bool> done(false);
+    std::atomic<pxcI64> reads(0);
+
+    /* one thread reads the object while the others reference it */
+    std::thread reader([&]() {
+        pxcI64 n = 0;
+        ready++;
+        while (ready.load() <= nthreads) std::this_thread::yield();
+        while (!done.load(std::memory_order_relaxed)) {
+            for (int i = 0; i < 256; i++) object->QueryTimeStamp();
+            n += 256;
+        }
+        reads = n;
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; t++) {
+        threads.push_back(std::thread([&]() {
+            ready++;
+            while (ready.load() <= nthreads) std::this_thread::yield();
+            for (pxcI64 i = 0; i < iterations; i++) {
+                object->AddRef();
+                object->Release();
+            }
+        }));
+    }
+
+    while (ready.load() < nthreads + 1) std::this_thread::yield();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ready++;
+    for (int t = 0; t < nthreads; t++) threads[t].join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    done = true;
+    reader.join();
+    object->Release();
+
+    Result result;
+    result.refsPerSecond = (double)nthreads * iterations / seconds;
+    result.readsPerSecond = (double)reads.load() / seconds;
+    return result;
+}
+
+static void Print(const char *name, const Result &result) {
+    printf("%-24s %10.1f M refs/s %10.1f M reads/s\n", name, result.refsPerSecond / 1e6, result.readsPerSecond / 1e6);
+}
+
+/* usage: pxcaddref_benchmark [threads] [iterations per thread] */
+int main(int argc, char *argv[]) {
+    int nthreads = (argc > 1) ? atoi(argv[1]) : (int)std::thread::hardware_concurrency() - 1;
+    pxcI64 iterations = (argc > 2) ? atoll(argv[2]) : 2000000;
+    if (nthreads < 1) nthreads = 1;
+    if (iterations < 1) iterations = 1;
+
+    printf("%d referencing threads, %lld AddRef/Release pairs each, one reader\n", nthreads, (long long)iterations);
+    Result seqCst = Run<SeqCstRefCount>(nthreads, iterations);
+    Result relaxed = Run<PXCRefCount>(nthreads, iterations);
+    Print("seq_cst, unpadded", seqCst);
+    Print("PXCRefCount", relaxed);
+    printf("%-24s %10.2fx refs %9.2fx reads\n", "gain", relaxed.refsPerSecond / seqCst.refsPerSecond, relaxed.readsPerSecond / seqCst.readsPerSecond);
+    return 0;
+}
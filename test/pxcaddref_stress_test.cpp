@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/* Stresses PXCRefCount with references that the owner creates and other threads
+   release, and shows why PXCAddRefImpl does not use a biased counter: without an
+   owner-side merge queue, such references are never merged back and the object leaks. */
+#include "pxcaddref.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+class Frame:public PXCBase {
+public:
+    PXC_CUID_OVERWRITE(PXC_UID('S','F','R','M'));
+};
+
+static std::atomic<int> g_destroyed(0);
+static std::atomic<int> g_incomplete(0);
+
+/* Each releasing thread writes its slot before its last Release; the destructor
+   checks that the final decrement made every write visible. */
+class Object:public PXCAddRefImpl<PXCBaseImpl<Frame> > {
+public:
+    explicit Object(int nthreads):slots(nthreads, 0) {}
+    virtual ~Object(void) {
+        for (size_t i = 0; i < slots.size(); i++)
+            if (slots[i] != 1) g_incomplete++;
+        g_destroyed++;
+    }
+
+    std::vector<int> slots;
+};
+
+/* A biased counter as the request described it: the owner thread counts in a plain
+   integer, other threads in a shared atomic, and there is no queue through which
+   the owner merges the shared count back. */
+class BiasedRefCount {
+public:
+    explicit BiasedRefCount(std::thread::id owner):owner(owner),local(1),shared(0) {}
+
+    void Increment(void) {
+        if (std::this_thread::get_id() == owner) local++;
+        else shared.fetch_add(1);
+    }
+
+    /* Return true when this release dropped the last reference it can see. */
+    bool Decrement(void) {
+        if (std::this_thread::get_id() == owner) return --local == 0 && shared.load() == 0;
+        return shared.fetch_sub(1) - 1 == 0 && local == 0;
+    }
+
+protected:
+    std::thread::id     owner;
+    int                 local;
+    std::atomic<int>    shared;
+};
+
+/* The owner hands one reference per round to every thread, which releases it
+   after a burst of its own AddRef/Release pairs. */
+static void RunRefCount(int nthreads, int rounds, int churn) {
+    for (int r = 0; r < rounds; r++) {
+        Object *object = new Object(nthreads);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nthreads; t++) {
+            object->AddRef();
+            threads.push_back(std::thread([object, t, churn]() {
+                for (int i = 0; i < churn; i++) {
+                    object->AddRef();
+                    object->Release();
+                }
+                object->slots[t] = 1;
+                object->Release();
+            }));
+        }
+        object->Release();
+        for (int t = 0; t < nthreads; t++) threads[t].join();
+    }
+}
+
+/* Return the number of objects the biased counter never frees. */
+static int RunBiased(int nthreads, int rounds) {
+    int leaked = 0;
+    for (int r = 0; r < rounds; r++) {
+        BiasedRefCount count(std::this_thread::get_id());
+        std::atomic<int> freed(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nthreads; t++) {
+            count.Increment();
+            threads.push_back(std::thread([&count, &freed]() {
+                if (count.Decrement()) freed++;
+            }));
+        }
+        for (int t = 0; t < nthreads; t++) threads[t].join();
+        if (count.Decrement()) freed++;
+        if (!freed.load()) leaked++;
+    }
+    return leaked;
+}
+
+/* usage: pxcaddref_stress_test [threads] [rounds] */
+int main(int argc, char *argv[]) {
+    int nthreads = (argc > 1) ? atoi(argv[1]) : 8;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 2000;
+    if (nthreads < 1) nthreads = 1;
+    if (rounds < 1) rounds = 1;
+
+    RunRefCount(nthreads, rounds, 64);
+    int failures = 0;
+    if (g_destroyed.load() != rounds) {
+        printf("PXCRefCount: %d of %d objects destroyed\n", g_destroyed.load(), rounds);
+        failures++;
+    }
+    if (g_incomplete.load()) {
+        printf("PXCRefCount: %d writes not visible to the destructor\n", g_incomplete.load());
+        failures++;
+    }
+    printf("PXCRefCount: %d of %d objects destroyed once, %d threads\n", g_destroyed.load(), rounds, nthreads);
+    printf("biased counter without a merge queue: %d of %d objects leaked\n", RunBiased(nthreads, rounds), rounds);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+/*
+Copyright (c) 2016, Intel Corporation
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Intel Corporation nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/* Checks that every SIMD color conversion kernel is bit-exact with its scalar reference. */
+#include "service/pxcimageconversion.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+struct TestImage {
+    std::vector<pxcBYTE>    planes[2];
+    PXCImage::ImageData     data;
+};
+
+static int BytesPerPixel(PXCImage::PixelFormat format) {
+    switch (format) {
+    case PXCImage::PIXEL_FORMAT_YUY2:   return 2;
+    case PXCImage::PIXEL_FORMAT_RGB32:  return 4;
+    case PXCImage::PIXEL_FORMAT_RGB24:  return 3;
+    default:                            return 1;
+    }
+}
+
+/* Allocate an image with padded pitches; the source gets random pixels and the
+   destinations a fixed pattern, so writes past a row are caught as mismatches. */
+static void InitImage(TestImage *image, PXCImage::PixelFormat format, int width, int height, bool random) {
+    int evenWidth = (width + 1) & ~1;
+    memset(&image->data, 0, sizeof(image->data));
+    image->data.format = format;
+    image->data.pitches[0] = BytesPerPixel(format) * (format == PXCImage::PIXEL_FORMAT_YUY2 ? evenWidth : width) + 5;
+    image->planes[0].assign((size_t)image->data.pitches[0] * height + 64, 0xCD);
+    image->planes[1].clear();
+    if (format == PXCImage::PIXEL_FORMAT_NV12) {
+        image->data.pitches[1] = evenWidth + 3;
+        image->planes[1].assign((size_t)image->data.pitches[1] * ((height + 1) / 2) + 64, 0xCD);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (random) for (size_t j = 0; j < image->planes[i].size(); j++) image->planes[i][j] = (pxcBYTE)rand();
+        image->data.planes[i] = image->planes[i].empty() ? 0 : &image->planes[i][0];
+    }
+}
+
+int main(void) {
+    static const PXCImage::PixelFormat formats[] = {
+        PXCImage::PIXEL_FORMAT_YUY2, PXCImage::PIXEL_FORMAT_NV12, PXCImage::PIXEL_FORMAT_RGB32,
+        PXCImage::PIXEL_FORMAT_RGB24, PXCImage::PIXEL_FORMAT_Y8,
+    };
+    /* odd widths leave a scalar tail behind every vector width */
+    static const int sizes[][2] = {
+        { 1, 1 }, { 3, 3 }, { 15, 2 }, { 17, 5 }, { 31, 3 }, { 33, 7 }, { 63, 2 }, { 64, 4 },
+        { 65, 3 }, { 127, 2 }, { 129, 3 }, { 640, 2 }, { 641, 3 },
+    };
+    static const struct { pxcI32 features; const char *name; } levels[] = {
+        { PXCImageConversion::CPU_FEATURE_SSE41, "SSE4.1" },
+        { PXCImageConversion::CPU_FEATURE_SSE41 | PXCImageConversion::CPU_FEATURE_AVX2, "AVX2" },
+        { PXCImageConversion::CPU_FEATURE_SSE41 | PXCImageConversion::CPU_FEATURE_AVX2 | PXCImageConversion::CPU_FEATURE_AVX512, "AVX-512" },
+    };
+    const int nformats = sizeof(formats) / sizeof(formats[0]);
+    const int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    const int nlevels = sizeof(levels) / sizeof(levels[0]);
+
+    int failures = 0, checks = 0;
+    for (int l = 0; l < nlevels; l++) {
+        if (PXCImageConversion::SetCpuFeatures(levels[l].features) != levels[l].features) {
+            printf("%s: not supported by this processor, skipped\n", levels[l].name);
+            continue;
+        }
+        for (int s = 0; s < nsizes; s++) {
+            int width = sizes[s][0], height = sizes[s][1];
+            for (int i = 0; i < nformats; i++) {
+                for (int o = 0; o < nformats; o++) {
+                    if (!PXCImageConversion::IsSupported(formats[i], formats[o])) continue;
+                    TestImage src, ref, dst;
+                    InitImage(&src, formats[i], width, height, true);
+                    InitImage(&ref, formats[o], width, height, false);
+                    InitImage(&dst, formats[o], width, height, false);
+
+                    PXCImageConversion::SetCpuFeatures(PXCImageConversion::CPU_FEATURE_NONE);
+                    pxcStatus sts1 = PXCImageConversion::Convert(&src.data, &ref.data, width, height);
+                    PXCImageConversion::SetCpuFeatures(levels[l].features);
+                    pxcStatus sts2 = PXCImageConversion::Convert(&src.data, &dst.data, width, height);
+
+                    checks++;
+                    if (sts1 != PXC_STATUS_NO_ERROR || sts2 != PXC_STATUS_NO_ERROR
+                        || ref.planes[0] != dst.planes[0] || ref.planes[1] != dst.planes[1]) {
+                        printf("%s: %ls to %ls at %dx%d differs from the scalar reference\n",
+                            levels[l].name, PXCImage::PixelFormatToString(formats[i]), PXCImage::PixelFormatToString(formats[o]), width, height);
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+    PXCImageConversion::SetCpuFeatures(PXCImageConversion::CPU_FEATURE_ALL);
+    printf("%d of %d conversions bit-exact\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}